@@ -0,0 +1,75 @@
+#ifndef BATCH_RUNNER
+#define BATCH_RUNNER
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "EventTrace.h"
+#include "Landscape.h"
+
+typedef std::map<std::string, std::string> PropertyMap;
+
+/* props[key], or fallback when the key is missing or empty */
+std::string propOr(const PropertyMap& props, const std::string& key, const std::string& fallback);
+int propOr(const PropertyMap& props, const std::string& key, int fallback);
+
+class ResultStore;
+
+/* A model.props value varied by a driver, from "<prefix><key> = lower,upper";
+ * bounds written without a decimal point mark integer parameters */
+struct ParameterRange
+{
+	std::string key;
+	double lower;
+	double upper;
+	bool integer;
+};
+
+std::vector<ParameterRange> readParameterRanges(const PropertyMap& props, const std::string& prefix);
+/* maps a point of the unit cube onto property values, rounding integer parameters */
+PropertyMap toProperties(const std::vector<ParameterRange>& ranges, const std::vector<double>& u);
+
+/* Trajectories of one parameter vector, one row per seed */
+struct RunResult
+{
+	std::vector<std::vector<int> > households;
+	std::vector<std::vector<int> > capacity;
+	double seconds;
+};
+
+/* household column of a "year,households" file such as data/target_data.csv; empty,
+ * with an error printed, if the file does not open or has no rows */
+std::vector<double> readTargetTrajectory(const std::string& file);
+/* sum of squared household errors against the target, averaged over seeds */
+double trajectoryError(const RunResult& result, const std::vector<double>& target);
+
+/* Evaluates batches of parameter vectors in-process on worker threads.
+ * Every point overrides some model.props values; each point runs all seeds
+ * as lanes of one LockstepEngine on the shared landscape. */
+class BatchRunner{
+private:
+	const Landscape* landscape;
+	PropertyMap baseProps;
+	std::vector<unsigned int> seeds;
+	int threads;
+	EventTrace* trace;
+	ResultStore* results;
+	std::vector<double> resultTarget;
+
+public:
+	BatchRunner(const Landscape* land, const PropertyMap& props, const std::vector<unsigned int>& s, int nThreads);
+	~BatchRunner();
+
+	/* every run logs its household events as a stream named by its overrides */
+	void traceEvents(EventTrace* t) {trace = t; }
+	/* every run is appended to the store under its recordedParameters, with its
+	 * fitness against target unless target is empty */
+	void storeResults(ResultStore* store, const std::vector<double>& target) {results = store; resultTarget = target; }
+	RunResult runOne(const PropertyMap& overrides) const;
+	std::vector<RunResult> run(const std::vector<PropertyMap>& points) const;
+	const PropertyMap& getBaseProperties() const {return baseProps; }
+	const std::vector<unsigned int>& getSeeds() const {return seeds; }
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef BYTE_CODEC
+#define BYTE_CODEC
+
+#include <stddef.h>
+#include <stdint.h>
+#include <iostream>
+#include <string>
+
+/* The binary encodings shared by the snapshot, trace and results files:
+ * little-endian 32-bit words, LEB128 varints and zigzag signed varints. */
+
+inline void putWord(unsigned char* b, uint32_t value)
+{
+	b[0] = value;
+	b[1] = value >> 8;
+	b[2] = value >> 16;
+	b[3] = value >> 24;
+}
+
+inline uint32_t getWord(const unsigned char* b)
+{
+	return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+inline void putInt(std::string& bytes, uint32_t value)
+{
+	unsigned char b[4];
+	putWord(b, value);
+	bytes.append((const char*)b, 4);
+}
+
+inline void putInt(std::ostream& out, uint32_t value)
+{
+	unsigned char b[4];
+	putWord(b, value);
+	out.write((const char*)b, 4);
+}
+
+/* false at the end of the stream */
+inline bool getInt(std::istream& in, uint32_t& value)
+{
+	unsigned char b[4];
+	if(!in.read((char*)b, 4))
+	{
+		return false;
+	}
+	value = getWord(b);
+	return true;
+}
+
+inline void putVarint(std::string& bytes, uint32_t value)
+{
+	while(value >= 0x80)
+	{
+		bytes.push_back((char)(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back((char)value);
+}
+
+inline void putSigned(std::string& bytes, int value)
+{
+	putVarint(bytes, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+/* stops at the end of bytes, so a truncated varint reads short rather than past it */
+inline uint32_t getVarint(const std::string& bytes, size_t& pos)
+{
+	uint32_t value = 0;
+	for(int shift = 0; pos < bytes.size() && shift < 35; shift += 7)
+	{
+		uint32_t b = (unsigned char)bytes[pos++];
+		value |= (b & 0x7f) << shift;
+		if(b < 0x80)
+		{
+			break;
+		}
+	}
+	return value;
+}
+
+inline int getSigned(const std::string& bytes, size_t& pos)
+{
+	uint32_t value = getVarint(bytes, pos);
+	return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef CALIBRATION
+#define CALIBRATION
+
+#include <boost/random/mersenne_twister.hpp>
+#include <string>
+#include <vector>
+
+#include "BatchRunner.h"
+
+/* Bayesian-optimization calibration against target_data.csv.
+ * The calibrated parameters and their bounds come from
+ * "calibration.range.<model.props key> = lower,upper" entries. A Gaussian-process
+ * surrogate (squared-exponential kernel on the unit cube) is fitted to
+ * log(1 + sum of squared household errors) and each batch is chosen by
+ * expected improvement with the kriging-believer heuristic, then evaluated
+ * in parallel through the BatchRunner. */
+class Calibration{
+private:
+	const BatchRunner* runner;
+	std::vector<ParameterRange> dims;
+	std::vector<double> target;
+	int runs;
+	int batchSize;
+	int initialRuns;
+	boost::mt19937 rng;
+
+	/* evaluated points (unit cube) and their log fitness */
+	std::vector<std::vector<double> > X;
+	std::vector<double> Y;
+
+	/* surrogate state */
+	double lengthScale;
+	double noise;
+	double meanY, scaleY;
+	std::vector<double> L;		//Cholesky factor of the kernel matrix, row-major
+	std::vector<double> alpha;	//K^-1 (y - mean) / scale
+
+	std::vector<double> snap(const std::vector<double>& u) const;
+	double kernel(const std::vector<double>& a, const std::vector<double>& b, double ls) const;
+	bool factorize(const std::vector<std::vector<double> >& x, const std::vector<double>& y, double ls, double nz, double& logLikelihood);
+	void fitSurrogate(const std::vector<std::vector<double> >& x, const std::vector<double>& y);
+	void predict(const std::vector<std::vector<double> >& x, const std::vector<double>& u, double& mean, double& sd) const;
+	std::vector<std::vector<double> > latinHypercube(int n);
+	std::vector<std::vector<double> > proposeBatch(int n);
+
+public:
+	Calibration(const BatchRunner* r, const PropertyMap& props);
+	~Calibration();
+
+	/* false if the target file does not open or has no rows */
+	bool readTarget(const std::string& file);
+	void run(std::ostream& out);
+	int getDimensions() const {return dims.size(); }
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef CLIMATE_SERIES
+#define CLIMATE_SERIES
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+/* One year of a climate table: "year","general","north","mid","natural","upland","kinbiko" */
+struct ClimateRow
+{
+	int year;
+	double general;
+	double north;
+	double mid;
+	double natural;
+	double upland;
+	double kinbiko;
+};
+
+/* Where the rows of a climate table lie on disk: the byte offset of every
+ * window-th row, so a series of any length costs one offset per window.
+ * Years must be consecutive. The index does not change once built and may be
+ * shared between threads; each ClimateReader rereads its windows on its own. */
+class ClimateSeries{
+private:
+	std::string file;
+	int firstYear;
+	int years;
+	int window;
+	std::vector<std::streamoff> blockOffset;
+
+public:
+	ClimateSeries();
+
+	/* false if the file has no rows; a gap in the years ends the series there */
+	bool index(const std::string& fileName, int windowRows);
+
+	const std::string& getFile() const {return file; }
+	int getFirstYear() const {return firstYear; }
+	int getLastYear() const {return firstYear + years - 1; }
+	int getYears() const {return years; }
+	int getWindow() const {return window; }
+	bool covers(int from, int to) const {return years > 0 && from >= firstYear && to <= getLastYear(); }
+	int getBlocks() const {return blockOffset.size(); }
+	std::streamoff offsetOf(int block) const {return blockOffset[block]; }
+};
+
+/* A window of consecutive rows of a series, reloaded from disk when a year
+ * outside it is asked for, so memory stays one window whatever the length. */
+class ClimateReader{
+private:
+	const ClimateSeries* series;
+	int windowYear;		//year of rows[0]
+	std::vector<ClimateRow> rows;
+	ClimateRow missing;
+
+	void load(int block);
+
+public:
+	ClimateReader(const ClimateSeries* s);
+
+	/* years outside the series read as a row of zeros */
+	const ClimateRow& at(int year);
+};
+
+/* Many climate series in memory at once, read from one table of
+ * "scenario","year","general","north","mid","natural","upland","kinbiko" rows
+ * grouped by scenario. Every scenario must cover the years of the first one.
+ * Columns are stored separately, each index (year - firstYear)*scenarios + s,
+ * so one year of every scenario is contiguous. */
+class ClimateEnsemble{
+private:
+	int firstYear;
+	int years;
+	std::vector<std::string> names;
+	std::vector<double> general, north, mid, natural, upland, kinbiko;
+
+public:
+	ClimateEnsemble();
+
+	/* false if no scenario could be read; scenarios not covering the span are dropped */
+	bool read(const std::string& fileName);
+
+	int getScenarios() const {return names.size(); }
+	const std::string& getName(int scenario) const {return names[scenario]; }
+	int getFirstYear() const {return firstYear; }
+	int getLastYear() const {return firstYear + years - 1; }
+	bool covers(int from, int to) const {return years > 0 && from >= firstYear && to <= getLastYear(); }
+	/* years outside the span read as zeros */
+	ClimateRow row(int scenario, int year) const;
+};
+
+#endif
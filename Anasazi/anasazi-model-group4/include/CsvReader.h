@@ -0,0 +1,47 @@
+#ifndef CSV_READER
+#define CSV_READER
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/* A csv file read into one buffer with a single read and tokenized in place:
+ * separators are overwritten with NULs, so fields are C strings inside the
+ * buffer and numbers parse without copies. Surrounding quotes are stripped and
+ * quoted fields may hold commas. Errors carry the file name and line. */
+class CsvReader{
+private:
+	std::string file;
+	std::vector<char> buffer;		//file contents plus a terminating NUL
+	size_t pos;
+	size_t rowOffset;
+	int line;
+	std::vector<char*> fields;
+	std::string error;
+
+	void load(const std::string& fileName, long offset, long length);
+
+public:
+	CsvReader(const std::string& fileName);
+	/* length bytes from offset on, or the rest of the file if length < 0; lines and
+	 * row offsets count from offset */
+	CsvReader(const std::string& fileName, long offset, long length);
+
+	bool failed() const {return !error.empty(); }
+	/* moves to the next non-blank row; false at the end of the file or after an error */
+	bool next();
+	int size() const {return fields.size(); }
+	const char* field(int i) const {return fields[i]; }
+	bool getInt(int i, int& value);
+	bool getDouble(int i, double& value);
+	/* false, with an error, unless the row has at least count fields */
+	bool expect(int count);
+	/* records "file:line: message" and returns false */
+	bool fail(const std::string& message);
+
+	size_t getRowOffset() const {return rowOffset; }
+	int getLine() const {return line; }
+	const std::string& getError() const {return error; }
+};
+
+#endif
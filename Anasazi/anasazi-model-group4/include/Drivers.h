@@ -0,0 +1,29 @@
+#ifndef DRIVERS
+#define DRIVERS
+
+#include <string>
+#include <vector>
+
+#include "BatchRunner.h"
+#include "Landscape.h"
+
+/* Entry points shared by main.exe and the Repast-free lite.exe */
+
+/* plain reader for model.props: "key = value" lines, '#' starts a comment;
+ * trailing "key=value" arguments override the file like repast::Properties */
+PropertyMap readProperties(const std::string& file, int argc, char** argv);
+
+/* reads the data files concurrently; false after a malformed file, which is
+ * reported on stderr. Climate tables are only indexed here. */
+bool loadLandscape(Landscape& landscape, const PropertyMap& props);
+
+/* random.seed, random.seed+1, ... one per replicate.lanes */
+std::vector<unsigned int> laneSeeds(const PropertyMap& props);
+
+/* runs run.mode (model or engine, calibrate, sensitivity, benchmark, scaling, scenarios, memory or
+ * worker) on the lockstep engine; run.mode = snapshot, trace or results decodes snapshot.file,
+ * trace.file or results.store into csv tables. Returns the exit status: 1 if the mode is
+ * unknown or its input could not be read */
+int runEngine(const PropertyMap& props);
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef EVENT_TRACE_LOG
+#define EVENT_TRACE_LOG
+
+#include <stdint.h>
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum TraceEventType
+{
+	TRACE_FISSION = 1,			//household: parent, amount: maize given to the child
+	TRACE_DEATH = 2,			//amount: age
+	TRACE_STARVATION = 3,		//no field within reach, household removed
+	TRACE_FOOD_SHARED = 4,		//household: the hungry one, amount: maize added to its storage
+	TRACE_RELOCATION = 5,		//cell: new dwelling, amount: distance from the old one
+	TRACE_MOVE_WITH_FRIENDS = 6	//household: the friend that followed, cell: its new field, amount: the household it followed
+};
+
+/* One binary record; year is the engine tick */
+struct TraceEvent
+{
+	int32_t year;
+	int16_t lane;
+	uint8_t type;
+	uint8_t unused;
+	int32_t household;
+	int32_t cell;
+	int32_t amount;
+};
+
+/* Single-producer ring of one run: the run's thread pushes, the trace's
+ * writer thread drains. A full ring makes the producer wait for the writer. */
+class TraceRing{
+private:
+	friend class EventTrace;
+	std::vector<TraceEvent> records;
+	uint32_t mask;
+	std::atomic<uint32_t> head;		//next record to push, written by the producer
+	std::atomic<uint32_t> tail;		//next record to drain, written by the writer
+	std::atomic<bool> finished;
+	int stream;
+	std::string label;
+	bool announced;
+
+	TraceRing(int s, const std::string& runLabel, int capacityLog2);
+
+public:
+	void push(int year, int lane, int type, int household, int cell, int amount)
+	{
+		uint32_t h = head.load(std::memory_order_relaxed);
+		while(h - tail.load(std::memory_order_acquire) > mask)
+		{
+			std::this_thread::yield();
+		}
+		TraceEvent& e = records[h & mask];
+		e.year = year;
+		e.lane = lane;
+		e.type = type;
+		e.unused = 0;
+		e.household = household;
+		e.cell = cell;
+		e.amount = amount;
+		head.store(h + 1, std::memory_order_release);
+	}
+};
+
+/* Household event log: a header, then chunks of (stream, count, records) in
+ * little-endian order as a writer thread drains the rings; a stream opens with
+ * a chunk of count -1 holding its label. Only builds with -DEVENT_TRACE record
+ * events, elsewhere TRACE_EVENT expands to nothing. */
+class EventTrace{
+private:
+	std::ofstream out;
+	int boardSizeY;
+	std::thread thread;
+	std::mutex mutex;
+	std::vector<TraceRing*> rings;
+	int nextStream;
+	std::atomic<bool> closing;
+
+	void worker();
+	bool drain(TraceRing* ring, std::string& bytes);
+
+public:
+	EventTrace(const std::string& file, int sizeY);
+	~EventTrace();
+
+	bool isOpen() const {return out.is_open(); }
+	/* a ring for one run, named by label in the decoded table */
+	TraceRing* open(const std::string& label);
+	/* the producer is done; the writer drains and frees the ring */
+	void close(TraceRing* ring);
+	/* drains every ring and closes the file */
+	void close();
+};
+
+/* decodes a trace into "Run,Year,Lane,Event,Household,X,Y,Amount" rows */
+bool writeTraceTable(const std::string& traceFile, std::ostream& out);
+
+#ifdef EVENT_TRACE
+#define TRACE_EVENT(ring, year, lane, type, household, cell, amount) \
+	do { if(ring) (ring)->push(year, lane, type, household, cell, amount); } while(0)
+#else
+#define TRACE_EVENT(ring, year, lane, type, household, cell, amount) do {} while(0)
+#endif
+
+#endif
@@ -14,6 +14,7 @@ private:
 	int maizeStorage;
 	int age;
 	int deathAge;
+	bool alive;	//false once removed; the agent leaves the context at the end of the tick
     /* Map to store closeness to other households */
     std::map<repast::AgentId, double > closenessMap;
 
@@ -26,6 +27,7 @@ public:
 	virtual const repast::AgentId& getId() const { return householdId; }
 
 	void setCloseness(const repast::AgentId& otherId, double value);
+	void eraseCloseness(const repast::AgentId& otherId) {closenessMap.erase(otherId); }
 
     // Getters for Proximity
 	double getCloseness(const repast::AgentId& otherId)	const;
@@ -38,6 +40,10 @@ public:
 
 	/* Getters specific to this kind of Agent */
 	Location* getAssignedField(){return assignedField; }
+	int getAge(){return age; }
+	int getDeathAge(){return deathAge; }
+	bool isAlive(){return alive; }
+	void markRemoved(){alive = false; }
 	int splitMaizeStored(int percentage);
 	
 	bool checkMaize(int needs);
@@ -0,0 +1,43 @@
+#ifndef HOUSEHOLD_SCHEDULE
+#define HOUSEHOLD_SCHEDULE
+
+#include <vector>
+
+/* Timing wheel of household age events keyed by the year of the household step.
+ * A household's age only changes through nextYear, so the years in which it
+ * reaches its death age or enters or leaves [minFissionAge, maxFissionAge] are
+ * known in advance. Each such year holds a recheck of the household; the caller
+ * refreshes the dying and fertile flags from the household's real age before
+ * the step, so a stale entry (a removed household, or one aged twice by
+ * MovewithFriends) costs a lookup and nothing else. Ids are household ids. */
+class HouseholdSchedule{
+private:
+	int minFissionAge, maxFissionAge;
+	std::vector<std::vector<int> > wheel;
+	int mask;
+	std::vector<char> dying;
+	std::vector<char> fertile;
+
+	void at(int year, int id) {wheel[year & mask].push_back(id); }
+	void grow(int id);
+
+public:
+	HouseholdSchedule(int minFission, int maxFission, int maxDeathAge);
+
+	/* forgets every household, as if newly constructed */
+	void reset(int minFission, int maxFission, int maxDeathAge);
+
+	/* a household that is first visited by the step of year, at the given age */
+	void add(int id, int year, int age, int deathAge);
+	/* the household was aged once more during the step of year */
+	void extraYear(int id, int year, int age, int deathAge);
+	/* moves the rechecks due before the step of year into ids */
+	void due(int year, std::vector<int>& ids);
+	void update(int id, int age, int deathAge);
+	void remove(int id);
+
+	bool isDying(int id) const {return dying[id]; }
+	bool isFertile(int id) const {return fertile[id]; }
+};
+
+#endif
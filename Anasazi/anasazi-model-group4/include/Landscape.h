@@ -0,0 +1,124 @@
+#ifndef LANDSCAPE
+#define LANDSCAPE
+
+#include <stdint.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ClimateSeries.h"
+
+class CsvReader;
+
+enum Zone
+{
+	EMPTY_ZONE = 0,
+	NATURAL = 1,
+	KINBIKO = 2,
+	UPLANDS = 3,
+	NORTH = 4,
+	GENERAL = 5,
+	NORTH_DUNES = 6,
+	MID_DUNES = 7,
+	MID = 8,
+	UNKNOWN_ZONE = 99
+};
+
+enum MaizeZone
+{
+	EMPTY_MAIZE = 0,
+	NO_YIELD = 1,
+	YIELD_1 = 2,	//North and Mid Valley, Kinbiko Canyon
+	YIELD_2 = 3,	//General Valley
+	YIELD_3 = 4,	//Arable Uplands
+	SAND_DUNE = 5,	//Dunes
+	UNKNOWN_MAIZE = 99
+};
+
+/* Static valley data shared by every replicate: zones, water sources and the
+ * index of the climate series. Cells are indexed x*boardSizeY + y, the order
+ * in which AnasaziModel::initAgents creates its Location agents.
+ * A cell is one byte: zone in bits 0-3, maize zone in bits 4-6 and whether the
+ * cell has any water source in bit 7; the unknown zones take the top codes.
+ * Water sources sit in a side table that only holds cells with sources. */
+class Landscape{
+private:
+	struct WaterSource
+	{
+		int waterType;
+		int startYear;
+		int endYear;
+	};
+
+	static const int ZONE_BITS = 0x0f;
+	static const int MAIZE_SHIFT = 4;
+	static const int MAIZE_BITS = 0x07;
+	static const int WATER_BIT = 0x80;
+
+	int boardSizeX, boardSizeY;
+	std::vector<uint8_t> cellCode;
+	/* ascending cells with water sources; those of waterCells[k] are waterSources[waterBegin[k] .. waterBegin[k+1]) */
+	std::vector<int> waterCells;
+	std::vector<int> waterBegin;
+	std::vector<WaterSource> waterSources;
+
+	bool readCell(CsvReader& csv, int xField, int& cell);
+	ClimateSeries pdsi;
+	ClimateSeries hydro;
+
+	/* rows: pdsi classes from < -3 to >= 3, columns: YIELD_1 .. SAND_DUNE */
+	static constexpr int yieldLevels[5][4] = { {617, 514, 411, 642},
+									{719, 599, 479, 749},
+									{821, 684, 547, 855},
+									{988, 824, 659, 1030},
+									{1153, 961, 769, 1201}};
+
+public:
+	Landscape(int sizeX, int sizeY);
+	~Landscape();
+
+	/* the readers report malformed rows on stderr and return false; map and
+	 * water both write the cell bytes and must not run at the same time */
+	bool readCsvMap(const std::string& file);
+	bool readCsvWater(const std::string& file);
+	bool readCsvPdsi(const std::string& file, int window);
+	bool readCsvHydro(const std::string& file, int window);
+	/* a synthetic board of tilesX by tilesY copies of this one, sharing its climate */
+	Landscape tile(int tilesX, int tilesY) const;
+	/* Zone and MaizeZone values of the names in map.csv, unknown for anything else */
+	static int zoneFromName(const char* name);
+	static int maizeZoneFromName(const char* name);
+
+	int getBoardSizeX() const {return boardSizeX; }
+	int getBoardSizeY() const {return boardSizeY; }
+	int getCellCount() const {return boardSizeX*boardSizeY; }
+	int getZone(int cell) const
+	{
+		int z = cellCode[cell] & ZONE_BITS;
+		return z == ZONE_BITS ? UNKNOWN_ZONE : z;
+	}
+	int getMaizeZone(int cell) const
+	{
+		int mz = (cellCode[cell] >> MAIZE_SHIFT) & MAIZE_BITS;
+		return mz == MAIZE_BITS ? UNKNOWN_MAIZE : mz;
+	}
+	bool hasWaterSource(int cell) const {return cellCode[cell] & WATER_BIT; }
+	/* indexes only; rows are read through a ClimateReader per user */
+	const ClimateSeries& getPdsi() const {return pdsi; }
+	const ClimateSeries& getHydro() const {return hydro; }
+
+	int yieldFromPdsi(int cell, const ClimateRow& p) const;
+	/* yieldFromPdsi in two steps: the pdsi a zone reads, truncated to int, then
+	 * its row of the yield table, YIELD_ROWS rows from driest to wettest */
+	static const int YIELD_ROWS = 5;
+	static bool zonePdsi(int zone, const ClimateRow& p, int& pdsiValue);
+	static int yieldRow(int pdsiValue);
+	int yieldFromRow(int cell, int row) const;
+	bool checkWater(int cell, bool existStreams, bool existAlluvium, int year) const;
+	static void checkWaterConditions(int year, bool& existStreams, bool& existAlluvium);
+
+	/* "Component,Bytes,Bytes.Per.Cell" rows of the landscape's own storage */
+	void memoryReport(std::ostream& out) const;
+};
+
+#endif
@@ -0,0 +1,332 @@
+#ifndef LOCKSTEP_ENGINE
+#define LOCKSTEP_ENGINE
+
+#include <stdint.h>
+#include <boost/random/mersenne_twister.hpp>
+#include <future>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "EventTrace.h"
+#include "HouseholdSchedule.h"
+#include "Landscape.h"
+#include "PopulationStats.h"
+#include "Snapshot.h"
+
+/* Behavioural modules on top of the Dean et al. household rules, selected by
+ * engine.features (all, none, or a list of sharing,friends,network,closeness).
+ * The household step is compiled once per feature set, so disabled modules
+ * cost nothing at run time. */
+enum EngineFeature
+{
+	FOOD_SHARING = 1,		//ShareFood before a hungry household searches
+	MOVE_WITH_FRIENDS = 2,	//MovewithFriends after a relocation
+	SOCIAL_NETWORK = 4,		//contact network grown at every fission
+	CLOSENESS = 8,			//yearly closeness update between households
+	ALL_FEATURES = 15
+};
+
+/* Model parameters as read from model.props */
+struct EngineParameters
+{
+	int boardSizeX;
+	int boardSizeY;
+	int countOfAgents;
+	int startYear;
+	int endYear;
+	int maxStorageYear;
+	int maxStorage;
+	int householdNeed;
+	int minFissionAge;
+	int maxFissionAge;
+	int minDeathAge;
+	int maxDeathAge;
+	int maxDistance;
+	int initMinCorn;
+	int initMaxCorn;
+	double annualVariance;
+	double spatialVariance;
+	double fertilityProbability;
+	double harvestAdjustment;
+	double maizeStorageRatio;
+	double thresholdSharefood;
+	double b1;
+	double b3;
+	double b4;
+	unsigned int features;
+	bool packedSoil;		//engine.soil.packed: 16-bit soil quality, not bit-identical to the default engine
+	bool lazyYield;			//engine.yield.lazy: harvests computed on first use, not bit-identical to the default engine
+
+	static unsigned int parseFeatures(const std::string& list);
+	static EngineParameters fromProperties(const std::map<std::string, std::string>& props);
+};
+
+/* Wall time of the parts of a tick, summed over the run */
+enum EnginePhase
+{
+	PHASE_LANDSCAPE = 0,	//water, yields and harvests of the year
+	PHASE_OUTPUT = 1,		//trajectories, statistics and snapshots
+	PHASE_HOUSEHOLDS = 2,	//the household step of every lane
+	PHASES = 3
+};
+
+/* Runs K replicates of the Anasazi model in lockstep over one shared Landscape.
+ * Each lane owns its random stream (seeded like repast::Random with the lane's
+ * seed) and its population; per-cell lane state (soil quality, yield noise,
+ * expected harvest, cell state) is stored interleaved as [cell*K + lane] so the
+ * yearly yield update is a single pass over all lanes.
+ * The household rules follow AnasaziModel step for step; households are
+ * visited in creation order. */
+class LockstepEngine{
+private:
+	/* Closeness of a household to another as of the lane's pass-th updateCloseness.
+	 * Only new co-residents need a draw, so a pass visits the co-residents alone; the
+	 * passes an entry missed are replayed when it is read or when either household
+	 * moves, as dwellings and fields are then the same as during those passes */
+	struct Tie
+	{
+		double value;
+		int pass;
+	};
+
+	/* households of one lane as parallel arrays indexed by slot, in creation order */
+	struct HouseholdStore
+	{
+		std::vector<int> id;
+		std::vector<int> cell;
+		std::vector<int> field;			//-1 before the first field search
+		std::vector<int> maizeStorage;
+		std::vector<int> age;
+		std::vector<int> deathAge;
+		std::vector<char> alive;
+		std::vector<std::map<int, Tie> > closenessMap;
+
+		int size() const {return id.size(); }
+		int add(int householdId, int a, int dAge, int mStorage);
+		void move(int from, int to);
+		void resize(int n);
+	};
+
+	struct Lane
+	{
+		unsigned int seed;
+		boost::mt19937 rng;
+		boost::mt19937 contactRng;				//network draws, apart from rng so they leave the household draws alone
+		int houseID;
+		int maxCapacity;
+		int closenessPasses;					//updateCloseness calls so far
+		bool Relocateflag;
+		HouseholdStore households;
+		std::vector<int> slotOfId;					//household id -> slot, -1 once removed
+		std::unordered_map<int, std::vector<int> > occupants;	//household ids per occupied dwelling cell, in arrival order
+		std::set<std::pair<int, int> > contacts;
+		std::unordered_map<int, int> searchCursor;			//origin cell -> first ring a field search from it must scan, this tick
+		std::vector<int> dueIds;
+		std::vector<char> hungry;
+		int work;								//households visited and cells searched in the last step
+		double load;							//work averaged over the steps, weights the lane groups
+		std::vector<int> dirtyCells;					//cells written since the last snapshot, while recording
+		std::vector<int> outYear;
+		std::vector<int> outHouseholds;
+		std::vector<int> outCapacity;
+	};
+
+	const Landscape* landscape;
+	ClimateReader pdsi;
+	EngineParameters param;
+	int year;
+	int stopAt;
+	int lanes;
+	int cells;
+	const double Probability = 0.5; //Probability of making the connection, [0 1]
+
+	/* per-year landscape; water is shared, yield levels differ per lane only under scenarios */
+	std::vector<char> water;
+	const ClimateEnsemble* scenarios;
+	int firstScenario;
+	int climateYear;				//year of water and yieldLevel
+	/* look-ahead buffers, empty unless lookAhead was called, and the task filling them */
+	std::vector<char> nextWater;
+	std::vector<int16_t> nextYieldLevel;
+	int nextClimateYear;
+	std::future<void> pending;
+
+	/* interleaved lane state, index cell*lanes + lane; soil quality is either
+	 * exact or, with packedSoil, 1/8192 steps from SOIL_MIN in soilCode;
+	 * with lazyYield, yieldLevel holds the yield-table row of every zone instead,
+	 * index zone*lanes + lane */
+	std::vector<int16_t> yieldLevel;
+	std::vector<double> soilQuality;
+	std::vector<uint16_t> soilCode;
+	std::vector<int> expectedHarvest;
+	std::vector<signed char> state;
+	static constexpr double SOIL_MIN = -3.0;
+	static constexpr double SOIL_STEP = 1.0/8192;
+	/* yield noise of NOISE_BLOCK cells of every lane, index cell*lanes + lane within the block */
+	std::vector<double> yieldNoise;
+	static const int NOISE_BLOCK = 256;
+
+	/* Lazy yield: a cell's noise is the normal quantile of (cellShift + yearShift)
+	 * as a 32-bit fraction, both hashed from the lane seed, and expectedHarvest is
+	 * filled on first use in a year (harvestYear, climateYear - startYear, -1 before).
+	 * Whether a cell feeds a household is then an arc of yearShift values per
+	 * yield-table row, so maxCapacity is counted from the sorted arc ends of every
+	 * zone and row instead of from the cells. */
+	struct CapacityArcs
+	{
+		int always;				//cells that feed a household whatever the noise
+		int wrapping;			//arcs that contain shift 0
+		std::vector<uint32_t> starts;
+		std::vector<uint32_t> ends;
+
+		int count(uint32_t shift) const;
+	};
+	static const int ZONE_GROUPS = MID + 1;		//zones with a pdsi column; the rest grow nothing
+	std::vector<int32_t> harvestYear;			//years since startYear, which may span more than 16 bits
+	std::vector<CapacityArcs> capacityArcs;		//index (lane*ZONE_GROUPS + zone)*YIELD_ROWS + row
+	std::vector<uint32_t> yearShift;
+
+	std::vector<Lane> laneData;
+	std::vector<HouseholdSchedule> laneSchedule;
+
+	/* with stepLanesOn, group g steps lanes groupStart[g] .. groupStart[g+1]-1,
+	 * group 0 on the calling thread and the rest on workers */
+	struct LaneWorkers;
+	LaneWorkers* workers;
+	std::vector<int> groupStart;
+	double balanceThreshold;
+	int rebalances;
+
+	SnapshotWriter* snapshot;
+	int snapshotEvery;
+	/* cell state as of each lane's last snapshot, interleaved like state; SHOWN_DIRTY
+	 * marks the cells queued in the lane's dirtyCells */
+	std::vector<signed char> shownState;
+	static const signed char SHOWN_DIRTY = 0x40;
+	TraceRing* trace;
+	double phaseSeconds[PHASES];
+
+	/* one per lane while statistics are collected, else empty */
+	std::vector<PopulationStats> laneStats;
+	int statsAgeBin;
+
+	int at(int cell, int lane) const {return cell*lanes + lane; }
+	double soilAt(int i) const {return soilCode.empty() ? soilQuality[i] : SOIL_MIN + soilCode[i]*SOIL_STEP; }
+	void setSoil(int i, double value);
+	void setState(int cell, int lane, signed char value)
+	{
+		int i = at(cell, lane);
+		if(!shownState.empty() && !(shownState[i] & SHOWN_DIRTY))
+		{
+			shownState[i] |= SHOWN_DIRTY;
+			laneData[lane].dirtyCells.push_back(cell);
+		}
+		state[i] = value;
+	}
+	int harvestAt(int cell, int lane)
+	{
+		int i = at(cell, lane);
+		if(param.lazyYield && harvestYear[i] != climateYear - param.startYear)
+		{
+			lazyHarvest(cell, lane);
+		}
+		return expectedHarvest[i];
+	}
+	void lazyHarvest(int cell, int lane);
+	uint32_t cellShift(int lane, int cell) const;
+	double noiseAt(uint32_t v) const;
+	void buildCapacityArcs();
+
+	const std::vector<int>& occupantsOf(int lane, int cell) const;
+	void placeHousehold(int lane, int slot, int cell);
+	void leaveCell(int lane, int slot);
+	void chooseField(int lane, int slot, int cell);
+	void nextYear(int lane, int slot);
+	void addMaize(int lane, int slot, int amount);
+	void dropHousehold(int lane, int slot);
+	bool checkMaize(int lane, int slot);
+	int getlackMaize(int lane, int slot);
+	double getCloseness(int lane, int slot, int otherId);
+	void setCloseness(int lane, int slot, int otherId, double value);
+	void settleTie(int lane, int slot, int other, Tie& tie, int passes);
+	void settleTies(int lane, int slot);
+	int firstFreeField(int lane, int x0, int y0, int range);
+	int searchField(int lane, int origin, int& range);
+	void freeCell(int lane, int cell);
+	int newHousehold(int lane, int age, int deathAge, int mStorage);
+	void compactHouseholds(int lane);
+	void copyLane(int from, int to);
+	void takeSnapshot(int lane);
+
+	void computeClimate(int forYear, std::vector<char>& waterOut, std::vector<int16_t>& yieldOut);
+	void updateClimate();
+
+	template<unsigned int F> void updateHouseholdProperties(int lane);
+	typedef void (LockstepEngine::*HouseholdStep)(int);
+	static const HouseholdStep householdSteps[ALL_FEATURES + 1];
+	void stepLaneGroup(int group);
+	void laneWorker(int group);
+	void rebalanceLanes();
+	void bisectLanes(const std::vector<double>& prefix, int lo, int hi, int g0, int g1);
+	bool fieldSearch(int lane, int slot);
+	void removeHousehold(int lane, int slot);
+	bool relocateHousehold(int lane, int slot);
+	void updateCloseness(int lane);
+	bool ShareFood(int lane, int slot);
+	bool MovewithFriends(int lane, int locgoal, int slot);
+
+	void initnetwork(int lane);
+	void addNewAgentContacts(int lane, int agentId);
+	bool checkConnection(int lane, int id1, int id2);
+
+public:
+	LockstepEngine(const Landscape* land, const EngineParameters& p, const std::vector<unsigned int>& seeds);
+	~LockstepEngine();
+
+	/* back to a new engine for p and seeds on the same landscape, reusing the cell
+	 * and household buffers; look-ahead and the lane threads stay on, snapshots,
+	 * traces, statistics and scenarios are dropped. With stepLanesOn, seeds must
+	 * hold at least one seed per lane group */
+	void reset(const EngineParameters& p, const std::vector<unsigned int>& seeds);
+	void initAgents();
+	void doPerTick();
+	void run();
+	void updateLocationProperties();
+	/* hands a frame of every lane to the writer every N ticks; the writer must outlive the run */
+	void recordSnapshots(SnapshotWriter* writer, int every);
+	/* pushes household events to the ring in builds with EVENT_TRACE; the ring must outlive the run */
+	void traceEvents(TraceRing* ring) {trace = ring; }
+	/* keeps PopulationStats per lane from initAgents on; call before initAgents */
+	void collectStatistics(int ageBinWidth);
+	/* computes each year's water and yield rasters on a helper thread while the
+	 * previous year's household step runs; results are unchanged */
+	void lookAhead();
+	/* steps the lanes' households on up to N threads in contiguous lane groups, split
+	 * again by recursive bisection on households and searched cells whenever the
+	 * busiest group carries more than imbalance times the mean; results are
+	 * unchanged. Lanes step on one thread while events are traced */
+	void stepLanesOn(int threads, double imbalance);
+	/* lane l reads the climate of scenario first + l instead of the landscape's pdsi,
+	 * and every lane starts from the population lane 0 draws; call before initAgents */
+	void useClimateScenarios(const ClimateEnsemble* ensemble, int first);
+
+	int getLanes() const {return lanes; }
+	int getYear() const {return year; }
+	int getHouseholdCount(int lane) const;
+	int getMaxCapacity(int lane) const {return laneData[lane].maxCapacity; }
+	double getPhaseSeconds(int phase) const {return phaseSeconds[phase]; }
+	int getRebalances() const {return rebalances; }
+	const std::vector<int>& getHouseholdTrajectory(int lane) const {return laneData[lane].outHouseholds; }
+	const std::vector<int>& getCapacityTrajectory(int lane) const {return laneData[lane].outCapacity; }
+	void writeOutputToFile(std::ostream& out) const;
+	void writeStatistics(std::ostream& out) const;
+	/* "Component,Bytes,Bytes.Per.Cell" rows of the engine's storage, all lanes together */
+	void memoryReport(std::ostream& out) const;
+};
+
+#endif
@@ -11,8 +11,8 @@
 #include <math.h>
 
 #include "Household.h"
-
-#define NUMBER_OF_YEARS 551
+#include "HouseholdSchedule.h"
+#include "ClimateSeries.h"
 
 class AnasaziModel{
 private:
@@ -68,27 +68,10 @@ private:
 		double b4;
 	} param;
 
-	struct PDSI
-	{
-		int year;
-		double pdsiGeneral;
-		double pdsiNorth;
-		double pdsiMid;
-		double pdsiNatural;
-		double pdsiUpland;
-		double pdsiKinbiko;
-	} pdsi[NUMBER_OF_YEARS];
-
-	struct Hydro
-	{
-		int year;
-		double hydroGeneral;
-		double hydroNorth;
-		double hydroMid;
-		double hydroNatural;
-		double hydroUpland;
-		double hydroKinbiko;
-	} hydro[NUMBER_OF_YEARS];
+	ClimateSeries pdsiSeries;	//row offsets only, rows are read a window at a time
+	ClimateSeries hydroSeries;
+	ClimateReader* pdsi;
+	ClimateReader* hydro;
 
 	const int yieldLevels[5][4] = { {617, 514, 411, 642},
 									{719, 599, 479, 749},
@@ -109,17 +92,31 @@ private:
 	repast::NormalGenerator* soilGen;// = repast::Random::instance()->createNormalGenerator(0,sqrt(0.1));
 	repast::IntUniformGenerator* initAgeGen;// = repast::Random::instance()->createUniIntGenerator(0,29);
 	repast::IntUniformGenerator* initMaizeGen;// = repast::Random::instance()->createUniIntGenerator(1000,1600);
+	HouseholdSchedule* schedule;	//death and fission-window years of every household
+	boost::mpi::communicator* world;
+	/* wall time of landscape, output, households and network, summed over the run */
+	static const int TIMING_PHASES = 4;
+	double phaseSeconds[TIMING_PHASES];
+	std::vector<int> householdTrajectory;	//as written to result.file, for results.store
+	std::vector<int> capacityTrajectory;
+	std::vector<repast::AgentId> removedHouseholds;	//tombstones of this tick
 
 public:
 	AnasaziModel(std::string propsFile, int argc, char** argv, boost::mpi::communicator* comm);
 	~AnasaziModel();
-	void initAgents();
+	/* false if a map, water or climate file failed to load; the model must not be run then */
+	bool initAgents();
 	void initSchedule(repast::ScheduleRunner& runner);
 	void doPerTick();
-	void readCsvMap();
-	void readCsvWater();
-	void readCsvPdsi();
-	void readCsvHydro();
+	/* gathers every rank's phase times to rank 0, which writes them to timing.file; collective */
+	void writeTiming();
+	/* appends the run to results.store; rank 0 only */
+	void storeResult();
+	bool readCsvMap();
+	bool readCsvWater();
+	int climateWindow();
+	bool readCsvPdsi();
+	bool readCsvHydro();
 	int yieldFromPdsi(int zone, int maizeZone);
 	double hydroLevel(int zone);
 	void checkWaterConditions();
@@ -128,6 +125,8 @@ public:
 	void updateHouseholdProperties();
 	bool fieldSearch(Household* household);
 	void removeHousehold(Household* household);
+	void removeDeadHouseholds();
+	void liveHouseholdsAt(int x, int y, std::vector<Household*>& householdList);
 	bool relocateHousehold(Household* household);
 
 	/*self add*/
@@ -138,6 +137,7 @@ public:
 
 	/*network*/
 	void addNewAgentContacts(int agentId);
+	void growContacts(int agents);
     	void setContact(int agentId1, int agentId2);
 	void disContact(int agentId1, int agentId2) ;
     	int getContactStatus(int agentId1, int agentId2);
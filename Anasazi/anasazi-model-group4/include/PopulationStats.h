@@ -0,0 +1,78 @@
+#ifndef POPULATION_STATS
+#define POPULATION_STATS
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/* Streaming quantiles with relative error alpha over a multiset that supports
+ * removal: values fall in logarithmic buckets, mirrored for negative values. */
+class QuantileSketch{
+private:
+	double gamma, logGamma;
+	std::vector<int> positive, negative;
+	int zeros;
+	int count;
+
+	int bucket(double magnitude) const;
+	void change(double value, int delta);
+	double bucketValue(int index) const;
+
+public:
+	QuantileSketch(double alpha);
+
+	void add(double value) {change(value, 1); }
+	void remove(double value) {change(value, -1); }
+	int size() const {return count; }
+	double quantile(double q) const;
+};
+
+/* Yearly population aggregates of one lane, kept up to date by the engine as
+ * households are created, fed, moved and removed instead of by a scan.
+ * Zones follow Landscape's Zone numbering, with one slot for unknown zones. */
+class PopulationStats{
+private:
+	struct YearRow
+	{
+		int year;
+		int households;
+		std::vector<int> ages;
+		std::vector<double> storage;
+		int fedByShare;
+		int relocations;
+		std::vector<int> zones;
+	};
+
+	int ageBin;
+	std::vector<int> ageCount;		//exact ages, the last entry also counts older households
+	QuantileSketch storage;
+	std::vector<int> zoneCount;
+	int households;
+	int fedByShare;
+	int relocations;
+	std::vector<YearRow> rows;
+
+	static int zoneSlot(int zone);
+	int ageSlot(int age) const;
+
+public:
+	PopulationStats(int maxAge, int ageBinWidth);
+
+	void addHousehold(int age, int maizeStorage);
+	void removeHousehold(int age, int maizeStorage);
+	void changeStorage(int from, int to);
+	void ageHousehold(int age);
+	void enterZone(int zone) {zoneCount[zoneSlot(zone)]++; }
+	void leaveZone(int zone) {zoneCount[zoneSlot(zone)]--; }
+	void fedBySharing() {fedByShare++; }
+	void relocated() {relocations++; }
+
+	/* appends the current aggregates as the row of this year; the event counts
+	 * cover the household step since the previous row and are reset */
+	void record(int year);
+
+	static void writeHeader(std::ostream& out, int maxAge, int ageBinWidth, bool withSeed);
+	void write(std::ostream& out, const std::string& prefix) const;
+};
+
+#endif
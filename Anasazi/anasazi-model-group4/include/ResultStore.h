@@ -0,0 +1,83 @@
+#ifndef RESULT_STORE
+#define RESULT_STORE
+
+#include <stdint.h>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "BatchRunner.h"
+
+/* One run as stored: a parameter vector run for every seed, one trajectory per seed */
+struct StoredRun
+{
+	PropertyMap parameters;
+	std::vector<unsigned int> seeds;
+	double fitness;			//NaN without a target trajectory
+	double seconds;
+	int firstYear;
+	std::vector<std::vector<int> > households;
+	std::vector<std::vector<int> > capacity;
+};
+
+/* FNV-1a of the "key=value" lines */
+uint64_t parameterHash(const PropertyMap& parameters);
+
+/* the values every writer files a run under, taken from its full properties: the
+ * results.parameters list, or else every calibration.range.* and
+ * sensitivity.range.* key; numbers are written as %.10g so equal values hash alike */
+PropertyMap recordedParameters(const PropertyMap& props);
+
+/* Results file: a header, then one row group per run, appended whole by a single
+ * write under an exclusive flock, so threads and processes can share a file.
+ * A row group is (raw size, packed size, parameter hash) and a zlib-compressed
+ * body holding the parameters, seeds, fitness and seconds, then every household
+ * trajectory and every maxCapacity trajectory as zigzag varint year-on-year
+ * differences. */
+class ResultStore{
+private:
+	std::string file;
+	int fd;
+	std::mutex mutex;
+
+public:
+	ResultStore(const std::string& fileName);
+	~ResultStore();
+
+	bool isOpen() const {return fd >= 0; }
+	/* compresses outside the lock; false if the write failed */
+	bool append(const StoredRun& run);
+};
+
+/* Reads a results file; opening scans the row-group headers only, so the hash
+ * index of a large sweep is built without decompressing it */
+class ResultReader{
+private:
+	mutable std::ifstream in;
+	std::vector<uint64_t> offsets;
+	std::vector<uint64_t> hashes;
+	std::unordered_multimap<uint64_t, int> index;
+
+public:
+	ResultReader(const std::string& fileName);
+
+	int size() const {return offsets.size(); }
+	uint64_t getHash(int i) const {return hashes[i]; }
+	/* row groups filed under exactly these parameters, in file order, from the hash index */
+	std::vector<int> find(const PropertyMap& parameters) const;
+	/* row groups whose parameters include these values, in file order; reads every group */
+	std::vector<int> match(const PropertyMap& parameters) const;
+	bool read(int i, StoredRun& run) const;
+};
+
+/* "Run,Hash,Parameters,Seeds,Fitness,Seconds,Mean.Households,Final.Households" rows
+ * of the row groups matching query ("key=value,..."; empty for all): the runs filed
+ * under exactly those values through the index, or if there are none the runs
+ * whose parameters include them, by a full scan; with trajectories, also their
+ * "Run,Seed,Year,Households,MaxCapacity" rows */
+bool writeResultTables(const std::string& storeFile, const std::string& query, std::ostream& runs, std::ostream* trajectories);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef SENSITIVITY
+#define SENSITIVITY
+
+#include <boost/random/mersenne_twister.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "BatchRunner.h"
+
+/* Variance-based global sensitivity analysis over the
+ * "sensitivity.range.<model.props key> = lower,upper" parameters.
+ * Two Monte Carlo sample matrices A and B of sensitivity.samples rows are
+ * drawn and, for every parameter i, the matrix AB_i (A with column i taken
+ * from B), so N*(d+2) runs give every index: first-order by the Saltelli
+ * (2010) estimator and total effect by Jansen's, both reusing the A and B
+ * runs for all parameters. Confidence half-widths come from a bootstrap
+ * over the sample rows. */
+class Sensitivity{
+private:
+	const BatchRunner* runner;
+	std::vector<ParameterRange> dims;
+	std::vector<double> target;
+	int samples;
+	int chunkRows;
+	boost::mt19937 rng;
+
+	std::vector<std::string> metricNames() const;
+	std::vector<double> metrics(const RunResult& result) const;
+	void estimate(const std::vector<double>& fA, const std::vector<double>& fB, const std::vector<double>& fAB,
+			const std::vector<int>& rows, std::vector<double>& first, std::vector<double>& total) const;
+
+public:
+	Sensitivity(const BatchRunner* r, const PropertyMap& props);
+	~Sensitivity();
+
+	/* file may be empty for no fitness metric; false if a named file cannot be read */
+	bool readTarget(const std::string& file);
+	void run(std::ostream& out);
+};
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef SNAPSHOT
+#define SNAPSHOT
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+struct SnapshotHousehold
+{
+	int id;
+	int cell;
+	int field;			//-1 before the first field search
+	int maizeStorage;
+	int age;
+};
+
+struct SnapshotCell
+{
+	int cell;			//x*boardSizeY + y
+	signed char state;
+};
+
+/* State of one lane at the point AnasaziModel::writeOutputToFile runs. Frames
+ * handed to the writer carry only changedCells, frames read back only cellState */
+struct SnapshotFrame
+{
+	int year;
+	int lane;
+	std::vector<signed char> cellState;				//0 empty, 1 household, 2 field, per cell x*boardSizeY + y
+	std::vector<SnapshotCell> changedCells;			//cells that differ from the lane's previous frame, ascending
+	std::vector<SnapshotHousehold> households;		//ascending id
+};
+
+/* Snapshot stream: a header, then zlib-compressed records of one or more frames.
+ * Only the cells that changed since the lane's previous frame are stored, and
+ * every household field is a zigzag varint difference from the same household
+ * in that frame, so unchanged cells and ageing households cost almost nothing.
+ * Encoding, compression and writing run on a background thread. */
+class SnapshotWriter{
+private:
+	std::ofstream out;
+	int boardSizeX, boardSizeY, lanes, level;
+	std::vector<SnapshotFrame> previous;		//households of each lane's last frame
+	static const size_t FRAMES_PER_RECORD = 64;
+	z_stream stream;							//reset per record
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::deque<SnapshotFrame> queue;
+	bool closing;
+
+	void worker();
+	void encode(const SnapshotFrame& frame, std::string& bytes);
+
+public:
+	SnapshotWriter(const std::string& file, int sizeX, int sizeY, int laneCount, int compression);
+	~SnapshotWriter();
+
+	/* false if the file did not open or zlib refused the compression level */
+	bool isOpen() const {return thread.joinable(); }
+
+	/* queues the frame and leaves it empty */
+	void write(SnapshotFrame& frame);
+	/* drains the queue and closes the file */
+	void close();
+};
+
+class SnapshotReader{
+private:
+	std::ifstream in;
+	int boardSizeX, boardSizeY, lanes;
+	std::vector<SnapshotFrame> previous;
+	std::string bytes;		//record being read, up to pos
+	size_t pos;
+
+public:
+	SnapshotReader(const std::string& file);
+	~SnapshotReader();
+
+	int getBoardSizeX() const {return boardSizeX; }
+	int getBoardSizeY() const {return boardSizeY; }
+	int getLanes() const {return lanes; }
+	/* false if the file is missing or not a snapshot stream */
+	bool isOpen() const {return in.is_open(); }
+
+	/* false at the end of the stream */
+	bool next(SnapshotFrame& frame);
+};
+
+/* decodes a snapshot stream into a household table and a table of occupied cells;
+ * false if the file is not a snapshot stream */
+bool writeSnapshotTables(const std::string& snapshotFile, std::ostream& households, std::ostream& cells);
+
+#endif
@@ -0,0 +1,185 @@
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <sstream>
+#include <vector>
+
+#include "BatchRunner.h"
+#include "LockstepEngine.h"
+#include "ResultStore.h"
+
+std::string propOr(const PropertyMap& props, const std::string& key, const std::string& fallback)
+{
+	PropertyMap::const_iterator it = props.find(key);
+	return it == props.end() || it->second.empty() ? fallback : it->second;
+}
+
+int propOr(const PropertyMap& props, const std::string& key, int fallback)
+{
+	PropertyMap::const_iterator it = props.find(key);
+	return it == props.end() || it->second.empty() ? fallback : atoi(it->second.c_str());
+}
+
+std::vector<ParameterRange> readParameterRanges(const PropertyMap& props, const std::string& prefix)
+{
+	std::vector<ParameterRange> ranges;
+	for(PropertyMap::const_iterator it = props.begin(); it != props.end(); ++it)
+	{
+		if(it->first.compare(0, prefix.size(), prefix) != 0)
+		{
+			continue;
+		}
+		ParameterRange range;
+		range.key = it->first.substr(prefix.size());
+		std::string bounds = it->second;
+		size_t comma = bounds.find(',');
+		range.lower = atof(bounds.substr(0, comma).c_str());
+		range.upper = comma == std::string::npos ? range.lower : atof(bounds.substr(comma + 1).c_str());
+		range.integer = bounds.find('.') == std::string::npos;
+		ranges.push_back(range);
+	}
+	return ranges;
+}
+
+PropertyMap toProperties(const std::vector<ParameterRange>& ranges, const std::vector<double>& u)
+{
+	PropertyMap props;
+	for(size_t d = 0; d < ranges.size(); d++)
+	{
+		double value = ranges[d].lower + u[d]*(ranges[d].upper - ranges[d].lower);
+		std::ostringstream text;
+		if(ranges[d].integer)
+		{
+			text << (int)floor(value + 0.5);
+		}
+		else
+		{
+			text.precision(6);
+			text << value;
+		}
+		props[ranges[d].key] = text.str();
+	}
+	return props;
+}
+
+std::vector<double> readTargetTrajectory(const std::string& file)
+{
+	std::ifstream in(file.c_str());
+	std::string line;
+	std::vector<double> target;
+	while(getline(in, line))
+	{
+		size_t comma = line.find(',');
+		if(comma != std::string::npos)
+		{
+			target.push_back(atof(line.substr(comma + 1).c_str()));
+		}
+	}
+	if(!in.is_open())
+	{
+		std::cerr << "target: cannot open " << file << std::endl;
+	}
+	else if(target.empty())
+	{
+		std::cerr << "target: no year,households rows in " << file << std::endl;
+	}
+	return target;
+}
+
+double trajectoryError(const RunResult& result, const std::vector<double>& target)
+{
+	double total = 0;
+	for(size_t l = 0; l < result.households.size(); l++)
+	{
+		const std::vector<int>& h = result.households[l];
+		size_t n = std::min(h.size(), target.size());
+		for(size_t t = 0; t < n; t++)
+		{
+			total += (h[t] - target[t])*(h[t] - target[t]);
+		}
+	}
+	return result.households.empty() ? 0 : total / result.households.size();
+}
+
+BatchRunner::BatchRunner(const Landscape* land, const PropertyMap& props, const std::vector<unsigned int>& s, int nThreads)
+{
+	landscape = land;
+	baseProps = props;
+	seeds = s;
+	threads = nThreads > 0 ? nThreads : 1;
+	trace = NULL;
+	results = NULL;
+}
+
+BatchRunner::~BatchRunner() {}
+
+RunResult BatchRunner::runOne(const PropertyMap& overrides) const
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	PropertyMap props(baseProps);
+	std::string label;
+	for(PropertyMap::const_iterator it = overrides.begin(); it != overrides.end(); ++it)
+	{
+		props[it->first] = it->second;
+		label += (label.empty() ? "" : " ") + it->first + "=" + it->second;
+	}
+
+	EngineParameters param = EngineParameters::fromProperties(props);
+	LockstepEngine engine(landscape, param, seeds);
+	TraceRing* ring = trace ? trace->open(label) : NULL;
+	engine.traceEvents(ring);
+	engine.initAgents();
+	engine.run();
+	if(ring)
+	{
+		trace->close(ring);
+	}
+
+	RunResult result;
+	for(int l = 0; l < engine.getLanes(); l++)
+	{
+		result.households.push_back(engine.getHouseholdTrajectory(l));
+		result.capacity.push_back(engine.getCapacityTrajectory(l));
+	}
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if(results)
+	{
+		StoredRun stored;
+		stored.parameters = recordedParameters(props);
+		stored.seeds = seeds;
+		stored.fitness = resultTarget.empty() ? NAN : trajectoryError(result, resultTarget);
+		stored.seconds = result.seconds;
+		stored.firstYear = param.startYear;
+		stored.households = result.households;
+		stored.capacity = result.capacity;
+		results->append(stored);
+	}
+	return result;
+}
+
+std::vector<RunResult> BatchRunner::run(const std::vector<PropertyMap>& points) const
+{
+	std::vector<RunResult> results(points.size());
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> workers;
+	for(int t = 0; t < threads && t < (int)points.size(); t++)
+	{
+		workers.push_back(std::thread([&]() {
+			size_t i;
+			while((i = next++) < points.size())
+			{
+				results[i] = runOne(points[i]);
+			}
+		}));
+	}
+	for(size_t t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+	return results;
+}
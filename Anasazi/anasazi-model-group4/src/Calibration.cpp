@@ -0,0 +1,311 @@
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_real.hpp>
+
+#include "Calibration.h"
+
+Calibration::Calibration(const BatchRunner* r, const PropertyMap& props)
+{
+	runner = r;
+	dims = readParameterRanges(props, "calibration.range.");
+	runs = propOr(props, "calibration.runs", 100);
+	batchSize = std::max(1, propOr(props, "calibration.batch", 8));
+	initialRuns = propOr(props, "calibration.initial", std::max<int>(2*dims.size() + 2, batchSize));
+	rng.seed(propOr(props, "random.seed", 1));
+	lengthScale = 0.3;
+	noise = 1e-2;
+	meanY = 0;
+	scaleY = 1;
+}
+
+Calibration::~Calibration() {}
+
+bool Calibration::readTarget(const std::string& file)
+{
+	target = readTargetTrajectory(file);
+	return !target.empty();
+}
+
+//moves integer coordinates onto the values that will actually be run
+std::vector<double> Calibration::snap(const std::vector<double>& u) const
+{
+	std::vector<double> s(u);
+	for(size_t d = 0; d < dims.size(); d++)
+	{
+		double width = dims[d].upper - dims[d].lower;
+		if(dims[d].integer && width > 0)
+		{
+			s[d] = (floor(dims[d].lower + u[d]*width + 0.5) - dims[d].lower) / width;
+		}
+	}
+	return s;
+}
+
+double Calibration::kernel(const std::vector<double>& a, const std::vector<double>& b, double ls) const
+{
+	double r2 = 0;
+	for(size_t d = 0; d < a.size(); d++)
+	{
+		r2 += (a[d] - b[d])*(a[d] - b[d]);
+	}
+	return exp(-0.5*r2/(ls*ls));
+}
+
+bool Calibration::factorize(const std::vector<std::vector<double> >& x, const std::vector<double>& y, double ls, double nz, double& logLikelihood)
+{
+	int n = x.size();
+	meanY = 0;
+	for(int i = 0; i < n; i++) meanY += y[i];
+	meanY /= n;
+	scaleY = 0;
+	for(int i = 0; i < n; i++) scaleY += (y[i] - meanY)*(y[i] - meanY);
+	scaleY = n > 1 ? sqrt(scaleY/(n - 1)) : 1;
+	if(scaleY <= 0) scaleY = 1;
+
+	L.assign(n*n, 0);
+	for(int i = 0; i < n; i++)
+	{
+		for(int j = 0; j <= i; j++)
+		{
+			double sum = kernel(x[i], x[j], ls) + (i == j ? nz : 0);
+			for(int k = 0; k < j; k++)
+			{
+				sum -= L[i*n + k]*L[j*n + k];
+			}
+			if(i == j)
+			{
+				if(sum <= 0)
+				{
+					return false;
+				}
+				L[i*n + i] = sqrt(sum);
+			}
+			else
+			{
+				L[i*n + j] = sum / L[j*n + j];
+			}
+		}
+	}
+
+	//alpha = L^-T L^-1 y
+	alpha.assign(n, 0);
+	for(int i = 0; i < n; i++)
+	{
+		double sum = (y[i] - meanY)/scaleY;
+		for(int k = 0; k < i; k++) sum -= L[i*n + k]*alpha[k];
+		alpha[i] = sum / L[i*n + i];
+	}
+	double fit = 0, logDet = 0;
+	for(int i = 0; i < n; i++)
+	{
+		fit += alpha[i]*alpha[i];
+		logDet += log(L[i*n + i]);
+	}
+	for(int i = n - 1; i >= 0; i--)
+	{
+		double sum = alpha[i];
+		for(int k = i + 1; k < n; k++) sum -= L[k*n + i]*alpha[k];
+		alpha[i] = sum / L[i*n + i];
+	}
+	logLikelihood = -0.5*fit - logDet - 0.5*n*log(2*M_PI);
+	return true;
+}
+
+//picks length scale and noise by maximum marginal likelihood over a small grid
+void Calibration::fitSurrogate(const std::vector<std::vector<double> >& x, const std::vector<double>& y)
+{
+	const double scales[] = {0.05, 0.1, 0.2, 0.3, 0.5, 0.8, 1.2};
+	const double noises[] = {1e-4, 1e-2, 1e-1};
+	double best = -1e300;
+	for(int i = 0; i < 7; i++)
+	{
+		for(int j = 0; j < 3; j++)
+		{
+			double ll;
+			if(factorize(x, y, scales[i], noises[j], ll) && ll > best)
+			{
+				best = ll;
+				lengthScale = scales[i];
+				noise = noises[j];
+			}
+		}
+	}
+	double ll;
+	factorize(x, y, lengthScale, noise, ll);
+}
+
+void Calibration::predict(const std::vector<std::vector<double> >& x, const std::vector<double>& u, double& mean, double& sd) const
+{
+	int n = x.size();
+	std::vector<double> k(n), v(n);
+	double m = 0;
+	for(int i = 0; i < n; i++)
+	{
+		k[i] = kernel(x[i], u, lengthScale);
+		m += k[i]*alpha[i];
+	}
+	double var = 1;
+	for(int i = 0; i < n; i++)
+	{
+		double sum = k[i];
+		for(int j = 0; j < i; j++) sum -= L[i*n + j]*v[j];
+		v[i] = sum / L[i*n + i];
+		var -= v[i]*v[i];
+	}
+	mean = meanY + scaleY*m;
+	sd = scaleY*sqrt(std::max(var, 1e-12));
+}
+
+std::vector<std::vector<double> > Calibration::latinHypercube(int n)
+{
+	boost::uniform_real<> uniform(0, 1);
+	std::vector<std::vector<double> > points(n, std::vector<double>(dims.size()));
+	for(size_t d = 0; d < dims.size(); d++)
+	{
+		std::vector<int> strata(n);
+		for(int i = 0; i < n; i++) strata[i] = i;
+		for(int i = n - 1; i > 0; i--)
+		{
+			std::swap(strata[i], strata[(int)(uniform(rng)*(i + 1)) % (i + 1)]);
+		}
+		for(int i = 0; i < n; i++)
+		{
+			points[i][d] = (strata[i] + uniform(rng)) / n;
+		}
+	}
+	for(int i = 0; i < n; i++)
+	{
+		points[i] = snap(points[i]);
+	}
+	return points;
+}
+
+std::vector<std::vector<double> > Calibration::proposeBatch(int n)
+{
+	boost::uniform_real<> uniform(0, 1);
+	boost::normal_distribution<> jitter(0, 0.05);
+	std::vector<std::vector<double> > xs(X);
+	std::vector<double> ys(Y);
+	std::vector<std::vector<double> > batch;
+
+	for(int b = 0; b < n; b++)
+	{
+		fitSurrogate(xs, ys);
+		int bestIndex = std::min_element(ys.begin(), ys.end()) - ys.begin();
+		double best = ys[bestIndex];
+
+		//global candidates plus local perturbations of the incumbent
+		std::vector<std::vector<double> > candidates;
+		for(int c = 0; c < 2000; c++)
+		{
+			std::vector<double> u(dims.size());
+			for(size_t d = 0; d < dims.size(); d++) u[d] = uniform(rng);
+			candidates.push_back(snap(u));
+		}
+		for(int c = 0; c < 500; c++)
+		{
+			std::vector<double> u(xs[bestIndex]);
+			for(size_t d = 0; d < dims.size(); d++) u[d] = std::min(1.0, std::max(0.0, u[d] + jitter(rng)));
+			candidates.push_back(snap(u));
+		}
+
+		double bestEI = -1;
+		std::vector<double> chosen;
+		for(size_t c = 0; c < candidates.size(); c++)
+		{
+			bool seen = false;
+			for(size_t i = 0; i < xs.size() && !seen; i++)
+			{
+				seen = kernel(xs[i], candidates[c], 1) > 1 - 1e-12;
+			}
+			if(seen)
+			{
+				continue;
+			}
+			double mean, sd;
+			predict(xs, candidates[c], mean, sd);
+			double z = (best - mean)/sd;
+			double ei = (best - mean)*0.5*erfc(-z/sqrt(2.0)) + sd*exp(-0.5*z*z)/sqrt(2*M_PI);
+			if(ei > bestEI)
+			{
+				bestEI = ei;
+				chosen = candidates[c];
+			}
+		}
+		if(chosen.empty())
+		{
+			break;
+		}
+
+		//kriging believer: pretend the prediction was observed before choosing the next one
+		double mean, sd;
+		predict(xs, chosen, mean, sd);
+		xs.push_back(chosen);
+		ys.push_back(mean);
+		batch.push_back(chosen);
+	}
+	return batch;
+}
+
+void Calibration::run(std::ostream& out)
+{
+	out << "Run,Batch";
+	for(size_t d = 0; d < dims.size(); d++) out << "," << dims[d].key;
+	out << ",Fitness,Seconds" << std::endl;
+
+	int batchNo = 0;
+	double bestFitness = -1;
+	PropertyMap bestProps;
+	while((int)X.size() < runs)
+	{
+		std::vector<std::vector<double> > batch;
+		if(X.empty())
+		{
+			batch = latinHypercube(std::min(initialRuns, runs));
+		}
+		else
+		{
+			batch = proposeBatch(std::min(batchSize, runs - (int)X.size()));
+			if(batch.empty())
+			{
+				break;
+			}
+		}
+
+		std::vector<PropertyMap> points;
+		for(size_t i = 0; i < batch.size(); i++)
+		{
+			points.push_back(toProperties(dims, batch[i]));
+		}
+		std::vector<RunResult> results = runner->run(points);
+
+		for(size_t i = 0; i < batch.size(); i++)
+		{
+			double f = trajectoryError(results[i], target);
+			X.push_back(batch[i]);
+			Y.push_back(log(1 + f));
+			out << X.size() << "," << batchNo;
+			for(size_t d = 0; d < dims.size(); d++) out << "," << points[i][dims[d].key];
+			out << "," << f << "," << results[i].seconds << std::endl;
+			if(bestFitness < 0 || f < bestFitness)
+			{
+				bestFitness = f;
+				bestProps = points[i];
+			}
+		}
+		std::cout << "calibration batch " << batchNo << ": " << X.size() << " runs, best fitness " << bestFitness << std::endl;
+		batchNo++;
+	}
+
+	std::cout << "best parameters:";
+	for(PropertyMap::const_iterator it = bestProps.begin(); it != bestProps.end(); ++it)
+	{
+		std::cout << " " << it->first << "=" << it->second;
+	}
+	std::cout << " fitness=" << bestFitness << std::endl;
+}
@@ -0,0 +1,220 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ClimateSeries.h"
+#include "CsvReader.h"
+
+ClimateSeries::ClimateSeries()
+{
+	firstYear = 0;
+	years = 0;
+	window = 1;
+}
+
+//year and the six values from field first on
+static bool readRow(CsvReader& csv, int first, ClimateRow& row)
+{
+	return csv.expect(first + 7) && csv.getInt(first, row.year) && csv.getDouble(first + 1, row.general) && csv.getDouble(first + 2, row.north)
+		&& csv.getDouble(first + 3, row.mid) && csv.getDouble(first + 4, row.natural) && csv.getDouble(first + 5, row.upland)
+		&& csv.getDouble(first + 6, row.kinbiko);
+}
+
+bool ClimateSeries::index(const std::string& fileName, int windowRows)
+{
+	file = fileName;
+	firstYear = 0;
+	years = 0;
+	window = windowRows > 0 ? windowRows : 1;
+	blockOffset.clear();
+
+	CsvReader csv(fileName);
+	csv.next();//Ignore first line
+	ClimateRow row;
+	while(!csv.failed() && csv.next())
+	{
+		if(!readRow(csv, 0, row))
+		{
+			break;
+		}
+		if(years > 0 && row.year != firstYear + years)
+		{
+			csv.fail("year " + std::to_string(row.year) + " follows " + std::to_string(getLastYear()) + ", years must be consecutive");
+			break;
+		}
+		if(years == 0)
+		{
+			firstYear = row.year;
+		}
+		if(years % window == 0)
+		{
+			blockOffset.push_back(csv.getRowOffset());
+		}
+		years++;
+	}
+	if(!csv.failed() && years == 0)
+	{
+		csv.fail("no rows");
+	}
+	if(csv.failed())
+	{
+		std::cerr << "climate: " << csv.getError() << std::endl;
+		years = 0;
+		return false;
+	}
+	return true;
+}
+
+ClimateReader::ClimateReader(const ClimateSeries* s)
+	: series(s)
+{
+	windowYear = 0;
+	missing.year = 0;
+	missing.general = missing.north = missing.mid = 0;
+	missing.natural = missing.upland = missing.kinbiko = 0;
+}
+
+//rows are parsed by the same readRow that indexed them; a window that no longer
+//parses (the file changed since) is reported and reads as zeros
+void ClimateReader::load(int block)
+{
+	int first = block*series->getWindow();
+	int count = std::min(series->getWindow(), series->getYears() - first);
+	long offset = series->offsetOf(block);
+	long length = block + 1 < series->getBlocks() ? series->offsetOf(block + 1) - offset : -1;
+	CsvReader csv(series->getFile(), offset, length);
+	rows.resize(count);
+	for(int i = 0; i < count; i++)
+	{
+		if(!csv.next() || !readRow(csv, 0, rows[i]) || rows[i].year != series->getFirstYear() + first + i)
+		{
+			std::cerr << "climate: " << (csv.failed() ? csv.getError() : series->getFile() + ": rows changed since the file was indexed") << std::endl;
+			for(; i < count; i++)
+			{
+				rows[i] = missing;
+				rows[i].year = series->getFirstYear() + first + i;
+			}
+		}
+	}
+	windowYear = series->getFirstYear() + first;
+}
+
+const ClimateRow& ClimateReader::at(int year)
+{
+	int i = year - windowYear;
+	if(i >= 0 && i < (int)rows.size())
+	{
+		return rows[i];
+	}
+	if(!series->covers(year, year))
+	{
+		missing.year = year;
+		return missing;
+	}
+	load((year - series->getFirstYear()) / series->getWindow());
+	return rows[year - windowYear];
+}
+
+ClimateEnsemble::ClimateEnsemble()
+{
+	firstYear = 0;
+	years = 0;
+}
+
+bool ClimateEnsemble::read(const std::string& fileName)
+{
+	CsvReader csv(fileName);
+	csv.next();//Ignore first line
+
+	//rows of each scenario in file order, checked against the first scenario's span
+	std::vector<std::string> scenarioNames;
+	std::vector<std::vector<ClimateRow> > series;
+	ClimateRow row;
+	while(!csv.failed() && csv.next())
+	{
+		if(!readRow(csv, 1, row))
+		{
+			break;
+		}
+		if(scenarioNames.empty() || scenarioNames.back() != csv.field(0))
+		{
+			scenarioNames.push_back(csv.field(0));
+			series.push_back(std::vector<ClimateRow>());
+		}
+		series.back().push_back(row);
+	}
+	if(csv.failed())
+	{
+		std::cerr << "climate: " << csv.getError() << std::endl;
+		series.clear();
+	}
+
+	names.clear();
+	years = series.empty() ? 0 : series[0].size();
+	firstYear = series.empty() ? 0 : series[0][0].year;
+	std::vector<int> kept;
+	for(size_t s = 0; s < series.size(); s++)
+	{
+		bool consecutive = (int)series[s].size() == years;
+		for(int t = 0; consecutive && t < years; t++)
+		{
+			consecutive = series[s][t].year == firstYear + t;
+		}
+		if(!consecutive)
+		{
+			std::cerr << "climate: scenario " << scenarioNames[s] << " does not cover years " << firstYear << "-" << getLastYear() << " in order, dropped" << std::endl;
+			continue;
+		}
+		kept.push_back(s);
+		names.push_back(scenarioNames[s]);
+	}
+
+	int n = names.size();
+	std::vector<double>* columns[6] = {&general, &north, &mid, &natural, &upland, &kinbiko};
+	for(int v = 0; v < 6; v++)
+	{
+		columns[v]->assign(years*n, 0);
+	}
+	for(int s = 0; s < n; s++)
+	{
+		const std::vector<ClimateRow>& rows = series[kept[s]];
+		for(int t = 0; t < years; t++)
+		{
+			int i = t*n + s;
+			general[i] = rows[t].general;
+			north[i] = rows[t].north;
+			mid[i] = rows[t].mid;
+			natural[i] = rows[t].natural;
+			upland[i] = rows[t].upland;
+			kinbiko[i] = rows[t].kinbiko;
+		}
+	}
+	if(n == 0)
+	{
+		years = 0;
+		std::cerr << "climate: no scenarios in " << fileName << std::endl;
+	}
+	return n > 0;
+}
+
+ClimateRow ClimateEnsemble::row(int scenario, int year) const
+{
+	ClimateRow r;
+	r.year = year;
+	if(!covers(year, year))
+	{
+		r.general = r.north = r.mid = 0;
+		r.natural = r.upland = r.kinbiko = 0;
+		return r;
+	}
+	int i = (year - firstYear)*names.size() + scenario;
+	r.general = general[i];
+	r.north = north[i];
+	r.mid = mid[i];
+	r.natural = natural[i];
+	r.upland = upland[i];
+	r.kinbiko = kinbiko[i];
+	return r;
+}
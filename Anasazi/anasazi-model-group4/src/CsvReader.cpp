@@ -0,0 +1,169 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "CsvReader.h"
+
+CsvReader::CsvReader(const std::string& fileName)
+{
+	load(fileName, 0, -1);
+}
+
+CsvReader::CsvReader(const std::string& fileName, long offset, long length)
+{
+	load(fileName, offset, length);
+}
+
+void CsvReader::load(const std::string& fileName, long offset, long length)
+{
+	file = fileName;
+	pos = 0;
+	rowOffset = 0;
+	line = 0;
+	FILE* in = fopen(fileName.c_str(), "rb");
+	if(!in)
+	{
+		buffer.assign(1, 0);
+		fail("cannot open file");
+		return;
+	}
+	fseek(in, 0, SEEK_END);
+	long size = ftell(in);
+	offset = std::min(std::max(offset, 0L), std::max(size, 0L));
+	if(length < 0 || length > size - offset)
+	{
+		length = size - offset;
+	}
+	fseek(in, offset, SEEK_SET);
+	buffer.resize(length > 0 ? length + 1 : 1);
+	if(length > 0 && fread(&buffer[0], 1, length, in) != (size_t)length)
+	{
+		buffer.assign(1, 0);
+		fail("read failed");
+	}
+	buffer.back() = 0;
+	fclose(in);
+}
+
+bool CsvReader::next()
+{
+	fields.clear();
+	if(failed())
+	{
+		return false;
+	}
+	size_t end = buffer.size() - 1;
+	while(pos < end)
+	{
+		line++;
+		rowOffset = pos;
+		char* p = &buffer[pos];
+		//blank lines are skipped
+		if(*p == '\n' || (*p == '\r' && p[1] == '\n'))
+		{
+			pos += *p == '\r' ? 2 : 1;
+			continue;
+		}
+		while(true)
+		{
+			char* start = p;
+			char* stop;
+			if(*p == '"')
+			{
+				start = ++p;
+				while(*p && *p != '"')
+				{
+					p++;
+				}
+				stop = p;
+				if(*p == '"')
+				{
+					p++;
+				}
+				while(*p && *p != ',' && *p != '\n' && *p != '\r')
+				{
+					p++;
+				}
+			}
+			else
+			{
+				while(*p && *p != ',' && *p != '\n' && *p != '\r')
+				{
+					p++;
+				}
+				stop = p;
+			}
+			char separator = *p;
+			*stop = 0;
+			fields.push_back(start);
+			if(separator == ',')
+			{
+				p++;
+				continue;
+			}
+			if(separator == '\r')
+			{
+				p++;
+				separator = *p;
+			}
+			if(separator == '\n')
+			{
+				p++;
+			}
+			break;
+		}
+		pos = p - &buffer[0];
+		return true;
+	}
+	return false;
+}
+
+bool CsvReader::getInt(int i, int& value)
+{
+	if(i >= size())
+	{
+		return expect(i + 1);
+	}
+	char* end;
+	errno = 0;
+	long v = strtol(fields[i], &end, 10);
+	if(end == fields[i] || *end != 0 || errno != 0)
+	{
+		return fail("field " + std::to_string(i + 1) + " is not an integer: \"" + fields[i] + "\"");
+	}
+	value = v;
+	return true;
+}
+
+bool CsvReader::getDouble(int i, double& value)
+{
+	if(i >= size())
+	{
+		return expect(i + 1);
+	}
+	char* end;
+	value = strtod(fields[i], &end);
+	if(end == fields[i] || *end != 0)
+	{
+		return fail("field " + std::to_string(i + 1) + " is not a number: \"" + fields[i] + "\"");
+	}
+	return true;
+}
+
+bool CsvReader::expect(int count)
+{
+	if(size() < count)
+	{
+		return fail("expected " + std::to_string(count) + " fields, found " + std::to_string(size()));
+	}
+	return true;
+}
+
+bool CsvReader::fail(const std::string& message)
+{
+	error = file + ":" + std::to_string(line) + ": " + message;
+	return false;
+}
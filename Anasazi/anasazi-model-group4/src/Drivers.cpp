@@ -0,0 +1,749 @@
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Drivers.h"
+#include "LockstepEngine.h"
+#include "Calibration.h"
+#include "EventTrace.h"
+#include "ResultStore.h"
+#include "Sensitivity.h"
+#include "Snapshot.h"
+
+static std::string trim(const std::string& text)
+{
+	size_t begin = text.find_first_not_of(" \t\r");
+	if(begin == std::string::npos)
+	{
+		return "";
+	}
+	size_t end = text.find_last_not_of(" \t\r");
+	return text.substr(begin, end - begin + 1);
+}
+
+static void addProperty(PropertyMap& props, const std::string& line)
+{
+	size_t equals = line.find('=');
+	if(equals == std::string::npos)
+	{
+		return;
+	}
+	std::string key = trim(line.substr(0, equals));
+	if(!key.empty())
+	{
+		props[key] = trim(line.substr(equals + 1));
+	}
+}
+
+PropertyMap readProperties(const std::string& file, int argc, char** argv)
+{
+	PropertyMap props;
+	std::ifstream in(file.c_str());
+	std::string line;
+	while(getline(in, line))
+	{
+		std::string text = trim(line);
+		if(text.empty() || text[0] == '#')
+		{
+			continue;
+		}
+		addProperty(props, text);
+	}
+	for(int i = 0; i < argc; i++)
+	{
+		addProperty(props, argv[i]);
+	}
+	return props;
+}
+
+//map and water share the cell bytes, so they load in turn while the climate files load alongside
+bool loadLandscape(Landscape& landscape, const PropertyMap& props)
+{
+	int window = atoi(propOr(props, "climate.window", "64").c_str());
+	bool cells = false, pdsi = false, hydro = false;
+	std::thread cellReader([&]() {
+		cells = landscape.readCsvMap("data/map.csv") && landscape.readCsvWater("data/water.csv");
+	});
+	std::thread pdsiReader([&]() {
+		pdsi = landscape.readCsvPdsi("data/pdsi.csv", window);
+	});
+	hydro = landscape.readCsvHydro("data/hydro.csv", window);
+	cellReader.join();
+	pdsiReader.join();
+	return cells && pdsi && hydro;
+}
+
+std::vector<unsigned int> laneSeeds(const PropertyMap& props)
+{
+	std::vector<unsigned int> seeds;
+	unsigned int seed = strtoul(propOr(props, "random.seed", "1").c_str(), NULL, 10);
+	int lanes = atoi(propOr(props, "replicate.lanes", "1").c_str());
+	for(int l = 0; l < lanes; l++)
+	{
+		seeds.push_back(seed + l);
+	}
+	return seeds;
+}
+
+//seconds per replicate of each module on its own and all together, against the plain Dean et al. rules
+static void runBenchmark(const Landscape& landscape, const PropertyMap& props, std::ostream& out)
+{
+	const char* names[] = {"none", "sharing", "friends", "network", "closeness", "all"};
+	const unsigned int sets[] = {0, FOOD_SHARING, MOVE_WITH_FRIENDS, SOCIAL_NETWORK, CLOSENESS, ALL_FEATURES};
+	int repeats = std::max(1, atoi(propOr(props, "benchmark.repeats", "3").c_str()));
+	std::vector<unsigned int> seeds = laneSeeds(props);
+
+	out << "Features,Seconds,Overhead" << std::endl;
+	double baseline = 0;
+	for(int f = 0; f < 6; f++)
+	{
+		EngineParameters param = EngineParameters::fromProperties(props);
+		param.features = sets[f];
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for(int r = 0; r < repeats; r++)
+		{
+			LockstepEngine engine(&landscape, param, seeds);
+			engine.initAgents();
+			engine.run();
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / (repeats*seeds.size());
+		if(f == 0)
+		{
+			baseline = seconds;
+		}
+		out << names[f] << "," << seconds << "," << (baseline > 0 ? seconds/baseline - 1 : 0) << std::endl;
+	}
+}
+
+//one replicate per climate scenario, all from the same seed and initial population;
+//scenario.lanes scenarios share an engine and the engines run on run.threads workers
+static bool runScenarios(const Landscape& landscape, const EngineParameters& param, const PropertyMap& props)
+{
+	std::string file = propOr(props, "scenario.file", "");
+	if(file.empty())
+	{
+		std::cerr << "scenarios: set scenario.file to a csv of pdsi series" << std::endl;
+		return false;
+	}
+	ClimateEnsemble ensemble;
+	if(!ensemble.read(file))
+	{
+		return false;
+	}
+	if(!ensemble.covers(param.startYear, param.endYear))
+	{
+		std::cerr << "climate: scenarios cover " << ensemble.getFirstYear() << "-" << ensemble.getLastYear()
+			<< ", years outside it have a pdsi of 0" << std::endl;
+	}
+	int scenarios = ensemble.getScenarios();
+	int perEngine = std::max(1, atoi(propOr(props, "scenario.lanes", "16").c_str()));
+	int nThreads = atoi(propOr(props, "run.threads", "0").c_str());
+	if(nThreads <= 0)
+	{
+		nThreads = std::thread::hardware_concurrency();
+	}
+	unsigned int seed = strtoul(propOr(props, "random.seed", "1").c_str(), NULL, 10);
+
+	std::vector<std::vector<int> > households(scenarios), capacity(scenarios);
+	int engines = (scenarios + perEngine - 1) / perEngine;
+	//the climate look-ahead only pays when there are idle cores for it
+	bool lookAhead = propOr(props, "engine.lookahead", "true") == "true" && engines < nThreads;
+	std::atomic<int> next(0);
+	std::vector<std::thread> workers;
+	for(int t = 0; t < nThreads && t < engines; t++)
+	{
+		workers.push_back(std::thread([&]() {
+			int e;
+			while((e = next++) < engines)
+			{
+				int first = e*perEngine;
+				int count = std::min(perEngine, scenarios - first);
+				LockstepEngine engine(&landscape, param, std::vector<unsigned int>(count, seed));
+				engine.useClimateScenarios(&ensemble, first);
+				if(lookAhead)
+				{
+					engine.lookAhead();
+				}
+				engine.initAgents();
+				engine.run();
+				for(int l = 0; l < count; l++)
+				{
+					households[first + l] = engine.getHouseholdTrajectory(l);
+					capacity[first + l] = engine.getCapacityTrajectory(l);
+				}
+			}
+		}));
+	}
+	for(size_t t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+
+	std::ofstream out(propOr(props, "scenario.result.file", "scenarios.csv").c_str());
+	out << "Scenario,Year,Number-of-Households,maxCapacity" << std::endl;
+	for(int s = 0; s < scenarios; s++)
+	{
+		for(size_t t = 0; t < households[s].size(); t++)
+		{
+			out << ensemble.getName(s) << "," << param.startYear + t << "," << households[s][t] << "," << capacity[s][t] << "\n";
+		}
+	}
+	return true;
+}
+
+//bytes of the landscape and of an initialized engine with replicate.lanes lanes, and
+//the same per cell scaled to memory.cells for planning larger synthetic valleys
+static std::vector<int> intList(const std::string& text)
+{
+	std::vector<int> values;
+	std::stringstream list(text);
+	std::string item;
+	while(getline(list, item, ','))
+	{
+		int value = atoi(item.c_str());
+		if(value > 0)
+		{
+			values.push_back(value);
+		}
+	}
+	return values;
+}
+
+//wall seconds of runs engines on threads workers; phases gets each run's phase times added
+static double timeRuns(const Landscape& board, const EngineParameters& param, const std::vector<unsigned int>& seeds, int runs, int threads, double* phases)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::atomic<int> next(0);
+	std::mutex mutex;
+	std::vector<std::thread> workers;
+	for(int t = 0; t < threads; t++)
+	{
+		workers.push_back(std::thread([&]() {
+			while(next++ < runs)
+			{
+				LockstepEngine engine(&board, param, seeds);
+				engine.initAgents();
+				engine.run();
+				std::lock_guard<std::mutex> lock(mutex);
+				for(int p = 0; p < PHASES; p++)
+				{
+					phases[p] += engine.getPhaseSeconds(p);
+				}
+			}
+		}));
+	}
+	for(size_t t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//strong scaling: scaling.runs runs whatever the thread count; weak scaling: scaling.runs
+//per thread. Boards are scaling.tiles copies of the valley a side, with as many more
+//initial households. Speedup and efficiency are against the first thread count
+static void runScaling(const Landscape& landscape, const PropertyMap& props, std::ostream& out)
+{
+	std::vector<int> threads = intList(propOr(props, "scaling.threads", "1,2,4"));
+	std::vector<int> tiles = intList(propOr(props, "scaling.tiles", "1,2"));
+	int runs = std::max(1, atoi(propOr(props, "scaling.runs", "4").c_str()));
+	std::vector<unsigned int> seeds = laneSeeds(props);
+	if(threads.empty() || tiles.empty())
+	{
+		std::cerr << "scaling: scaling.threads and scaling.tiles need positive values" << std::endl;
+		return;
+	}
+
+	out << "Scaling,Tiles,Cells,Threads,Runs,Seconds,TicksPerSecond,Speedup,Efficiency,Landscape.Seconds,Output.Seconds,Households.Seconds" << std::endl;
+	for(size_t k = 0; k < tiles.size(); k++)
+	{
+		Landscape board = landscape.tile(tiles[k], tiles[k]);
+		EngineParameters param = EngineParameters::fromProperties(props);
+		param.boardSizeX = board.getBoardSizeX();
+		param.boardSizeY = board.getBoardSizeY();
+		param.countOfAgents *= tiles[k]*tiles[k];
+		int ticks = param.endYear - param.startYear + 1;
+		for(int weak = 0; weak < 2; weak++)
+		{
+			double baseline = 0;
+			for(size_t i = 0; i < threads.size(); i++)
+			{
+				int n = weak ? runs*threads[i] : runs;
+				double phases[PHASES] = {0, 0, 0};
+				double seconds = timeRuns(board, param, seeds, n, threads[i], phases);
+				if(i == 0)
+				{
+					baseline = seconds;
+				}
+				double scale = (double)threads[i]/threads[0];
+				double efficiency = weak ? baseline/seconds : baseline/seconds/scale;
+				out << (weak ? "weak" : "strong") << "," << tiles[k] << "," << board.getCellCount() << "," << threads[i] << "," << n << ","
+					<< seconds << "," << n*seeds.size()*ticks/seconds << "," << efficiency*scale << "," << efficiency;
+				for(int p = 0; p < PHASES; p++)
+				{
+					out << "," << phases[p]/n;
+				}
+				out << std::endl;
+			}
+		}
+	}
+}
+
+static void runMemoryReport(const Landscape& landscape, const EngineParameters& param, const PropertyMap& props, std::ostream& out)
+{
+	LockstepEngine engine(&landscape, param, laneSeeds(props));
+	engine.initAgents();
+	std::ostringstream rows;
+	landscape.memoryReport(rows);
+	engine.memoryReport(rows);
+
+	double cells = atof(propOr(props, "memory.cells", "0").c_str());
+	out << "Component,Bytes,Bytes.Per.Cell" << (cells > 0 ? ",Projected.Bytes" : "") << std::endl;
+	std::istringstream in(rows.str());
+	std::string line;
+	double total = 0, totalPerCell = 0;
+	while(getline(in, line))
+	{
+		size_t last = line.rfind(',');
+		double perCell = atof(line.substr(last + 1).c_str());
+		total += atof(line.substr(line.find(',') + 1).c_str());
+		totalPerCell += perCell;
+		out << line;
+		if(cells > 0)
+		{
+			out << "," << (size_t)(perCell*cells);
+		}
+		out << "\n";
+	}
+	out << "total," << (size_t)total << "," << totalPerCell;
+	if(cells > 0)
+	{
+		out << "," << (size_t)(totalPerCell*cells);
+	}
+	out << std::endl;
+}
+
+//NULL unless trace.file is set and the build records events
+static EventTrace* openTrace(const PropertyMap& props, int sizeY)
+{
+	std::string file = propOr(props, "trace.file", "");
+	if(file.empty())
+	{
+		return NULL;
+	}
+#ifdef EVENT_TRACE
+	return new EventTrace(file, sizeY);
+#else
+	(void)sizeY;
+	std::cerr << "trace: " << file << " not written, household events need a build with TRACE=-DEVENT_TRACE" << std::endl;
+	return NULL;
+#endif
+}
+
+static ResultStore* openResults(const PropertyMap& props)
+{
+	std::string file = propOr(props, "results.store", "");
+	return file.empty() ? NULL : new ResultStore(file);
+}
+
+static std::vector<double> resultTarget(const PropertyMap& props)
+{
+	std::string file = propOr(props, "calibration.target.file", "");
+	return file.empty() ? std::vector<double>() : readTargetTrajectory(file);
+}
+
+/* State a worker keeps between requests: the landscape is loaded once and the
+ * engine is reset in place, so a request costs its run alone. Requests run on
+ * the lockstep engine, not the Repast model, whose runs they match only in
+ * distribution */
+struct Worker
+{
+	const Landscape* landscape;
+	PropertyMap baseProps;
+	LockstepEngine* engine;
+	ResultStore* results;
+	std::vector<double> target;
+	int runs;
+};
+
+static bool readLine(FILE* in, std::string& line)
+{
+	line.clear();
+	int c;
+	while((c = getc(in)) != EOF && c != '\n')
+	{
+		line += (char)c;
+	}
+	return c != EOF || !line.empty();
+}
+
+//runs one request and writes its reply; keys the resident landscape was loaded
+//with cannot change
+static void serveRequest(Worker& worker, const std::string& request, std::ostream& out)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	PropertyMap overrides;
+	std::istringstream tokens(request);
+	std::string token;
+	while(tokens >> token)
+	{
+		addProperty(overrides, token);
+	}
+	PropertyMap props(worker.baseProps);
+	for(PropertyMap::const_iterator it = overrides.begin(); it != overrides.end(); ++it)
+	{
+		if(it->first == "board.size.x" || it->first == "board.size.y" || it->first == "climate.window")
+		{
+			out << "error," << it->first << " is fixed by the loaded landscape\n\n";
+			return;
+		}
+		props[it->first] = it->second;
+	}
+
+	EngineParameters param = EngineParameters::fromProperties(props);
+	std::vector<unsigned int> seeds = laneSeeds(props);
+	if(!worker.engine || worker.engine->getLanes() != (int)seeds.size())
+	{
+		delete worker.engine;
+		worker.engine = new LockstepEngine(worker.landscape, param, seeds);
+		if(propOr(worker.baseProps, "engine.lookahead", "true") == "true")
+		{
+			worker.engine->lookAhead();
+		}
+		worker.engine->stepLanesOn(atoi(propOr(worker.baseProps, "engine.threads", "1").c_str()),
+				atof(propOr(worker.baseProps, "engine.balance.threshold", "1.1").c_str()));
+	}
+	else
+	{
+		worker.engine->reset(param, seeds);
+	}
+	LockstepEngine& engine = *worker.engine;
+	engine.initAgents();
+	engine.run();
+
+	RunResult result;
+	for(int l = 0; l < engine.getLanes(); l++)
+	{
+		result.households.push_back(engine.getHouseholdTrajectory(l));
+		result.capacity.push_back(engine.getCapacityTrajectory(l));
+	}
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double fitness = worker.target.empty() ? NAN : trajectoryError(result, worker.target);
+	int run = ++worker.runs;
+	out << "run," << run << "," << result.seconds;
+	if(!worker.target.empty())
+	{
+		out << "," << fitness;
+	}
+	out << "\n";
+	for(int l = 0; l < engine.getLanes(); l++)
+	{
+		for(size_t t = 0; t < result.households[l].size(); t++)
+		{
+			out << seeds[l] << "," << param.startYear + (int)t << "," << result.households[l][t] << "," << result.capacity[l][t] << "\n";
+		}
+	}
+	out << "\n";
+
+	if(worker.results)
+	{
+		StoredRun stored;
+		stored.parameters = recordedParameters(props);
+		stored.seeds = seeds;
+		stored.fitness = fitness;
+		stored.seconds = result.seconds;
+		stored.firstYear = param.startYear;
+		stored.households = result.households;
+		stored.capacity = result.capacity;
+		worker.results->append(stored);
+	}
+}
+
+//serves requests until the stream ends or a "quit" line; false after a quit
+static bool serveStream(Worker& worker, FILE* in, FILE* out)
+{
+	std::string line;
+	while(readLine(in, line))
+	{
+		line = trim(line);
+		if(line == "quit")
+		{
+			return false;
+		}
+		if(line.empty() || line[0] == '#')
+		{
+			continue;
+		}
+		std::ostringstream reply;
+		serveRequest(worker, line, reply);
+		std::string text = reply.str();
+		if(fwrite(text.data(), 1, text.size(), out) != text.size() || fflush(out) != 0)
+		{
+			return true;
+		}
+	}
+	return true;
+}
+
+//a unix socket at worker.socket takes one client at a time, each for as many
+//requests as it sends; without it requests come on stdin and replies go to stdout.
+//False if the socket cannot be listened on
+static bool runWorker(const Landscape& landscape, const PropertyMap& props)
+{
+	Worker worker;
+	worker.landscape = &landscape;
+	worker.baseProps = props;
+	worker.engine = NULL;
+	worker.results = openResults(props);
+	worker.target = resultTarget(props);
+	worker.runs = 0;
+
+	bool listening = true;
+	std::string path = propOr(props, "worker.socket", "");
+	if(path.empty())
+	{
+		serveStream(worker, stdin, stdout);
+	}
+	else
+	{
+		int server = socket(AF_UNIX, SOCK_STREAM, 0);
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+		unlink(path.c_str());
+		if(server < 0 || path.size() >= sizeof(address.sun_path)
+			|| bind(server, (sockaddr*)&address, sizeof(address)) != 0 || listen(server, 8) != 0)
+		{
+			std::cerr << "worker: cannot listen on " << path << ": " << strerror(errno) << std::endl;
+			listening = false;
+		}
+		else
+		{
+			//a client that hangs up early must not end the worker
+			signal(SIGPIPE, SIG_IGN);
+			bool serving = true;
+			while(serving)
+			{
+				int client = accept(server, NULL, NULL);
+				if(client < 0)
+				{
+					serving = errno == EINTR;
+					continue;
+				}
+				FILE* in = fdopen(client, "r");
+				FILE* out = fdopen(dup(client), "w");
+				serving = serveStream(worker, in, out);
+				fclose(out);
+				fclose(in);
+			}
+			unlink(path.c_str());
+		}
+		if(server >= 0)
+		{
+			close(server);
+		}
+	}
+	delete worker.engine;
+	delete worker.results;
+	return listening;
+}
+
+int runEngine(const PropertyMap& props)
+{
+	std::string mode = propOr(props, "run.mode", "model");
+	if(mode == "snapshot")
+	{
+		std::ofstream households(propOr(props, "snapshot.households.file", "snapshot_households.csv").c_str());
+		std::ofstream cells(propOr(props, "snapshot.cells.file", "snapshot_cells.csv").c_str());
+		return writeSnapshotTables(propOr(props, "snapshot.file", "snapshot.bin"), households, cells) ? 0 : 1;
+	}
+	if(mode == "trace")
+	{
+		std::ofstream out(propOr(props, "trace.result.file", "trace.csv").c_str());
+		return writeTraceTable(propOr(props, "trace.file", "trace.bin"), out) ? 0 : 1;
+	}
+	if(mode == "results")
+	{
+		std::ofstream runs(propOr(props, "results.summary.file", "results.csv").c_str());
+		std::string trajectoryFile = propOr(props, "results.trajectories.file", "");
+		std::ofstream trajectories;
+		if(!trajectoryFile.empty())
+		{
+			trajectories.open(trajectoryFile.c_str());
+		}
+		return writeResultTables(propOr(props, "results.store", "results.store"), propOr(props, "results.query", ""),
+				runs, trajectoryFile.empty() ? NULL : &trajectories) ? 0 : 1;
+	}
+
+	EngineParameters param = EngineParameters::fromProperties(props);
+	Landscape landscape(param.boardSizeX, param.boardSizeY);
+	if(!loadLandscape(landscape, props))
+	{
+		return 1;
+	}
+	const ClimateSeries& pdsi = landscape.getPdsi();
+	if(!pdsi.covers(param.startYear, param.endYear))
+	{
+		std::cerr << "climate: " << pdsi.getFile() << " covers " << pdsi.getFirstYear() << "-" << pdsi.getLastYear()
+			<< ", years outside it have a pdsi of 0" << std::endl;
+	}
+
+	if(mode == "calibrate" || mode == "sensitivity")
+	{
+		int nThreads = atoi(propOr(props, "run.threads", "0").c_str());
+		if(nThreads <= 0)
+		{
+			nThreads = std::thread::hardware_concurrency();
+		}
+		BatchRunner runner(&landscape, props, laneSeeds(props), nThreads);
+		EventTrace* trace = openTrace(props, param.boardSizeY);
+		runner.traceEvents(trace);
+		ResultStore* results = openResults(props);
+		runner.storeResults(results, results ? resultTarget(props) : std::vector<double>());
+		bool started = true;
+		if(mode == "calibrate")
+		{
+			Calibration calibration(&runner, props);
+			started = calibration.readTarget(propOr(props, "calibration.target.file", "data/target_data.csv"));
+			if(started)
+			{
+				std::ofstream out(propOr(props, "calibration.result.file", "calibration.csv").c_str());
+				calibration.run(out);
+			}
+		}
+		else
+		{
+			Sensitivity sensitivity(&runner, props);
+			started = sensitivity.readTarget(propOr(props, "calibration.target.file", ""));
+			if(started)
+			{
+				std::ofstream out(propOr(props, "sensitivity.result.file", "sensitivity.csv").c_str());
+				sensitivity.run(out);
+			}
+		}
+		delete trace;
+		delete results;
+		return started ? 0 : 1;
+	}
+	if(mode == "benchmark")
+	{
+		runBenchmark(landscape, props, std::cout);
+		return 0;
+	}
+	if(mode == "scaling")
+	{
+		std::ofstream out(propOr(props, "scaling.result.file", "scaling.csv").c_str());
+		runScaling(landscape, props, out);
+		return 0;
+	}
+	if(mode == "scenarios")
+	{
+		return runScenarios(landscape, param, props) ? 0 : 1;
+	}
+	if(mode == "memory")
+	{
+		runMemoryReport(landscape, param, props, std::cout);
+		return 0;
+	}
+	if(mode == "worker")
+	{
+		return runWorker(landscape, props) ? 0 : 1;
+	}
+	if(mode != "model" && mode != "engine")
+	{
+		std::cerr << "run.mode: unknown mode " << mode << std::endl;
+		return 1;
+	}
+
+	LockstepEngine engine(&landscape, param, laneSeeds(props));
+	std::string snapshotFile = propOr(props, "snapshot.file", "");
+	SnapshotWriter* snapshot = NULL;
+	if(!snapshotFile.empty())
+	{
+		int compression = atoi(propOr(props, "snapshot.compression", "1").c_str());
+		if(compression < -1 || compression > 9)
+		{
+			std::cerr << "snapshot: snapshot.compression must be a zlib level from -1 to 9" << std::endl;
+			return 1;
+		}
+		snapshot = new SnapshotWriter(snapshotFile, param.boardSizeX, param.boardSizeY, engine.getLanes(), compression);
+		if(!snapshot->isOpen())
+		{
+			delete snapshot;
+			return 1;
+		}
+		engine.recordSnapshots(snapshot, atoi(propOr(props, "snapshot.every", "1").c_str()));
+	}
+	std::string statsFile = propOr(props, "stats.file", "");
+	if(!statsFile.empty())
+	{
+		engine.collectStatistics(atoi(propOr(props, "stats.age.bin", "5").c_str()));
+	}
+	if(propOr(props, "engine.lookahead", "true") == "true")
+	{
+		engine.lookAhead();
+	}
+	engine.stepLanesOn(atoi(propOr(props, "engine.threads", "1").c_str()),
+			atof(propOr(props, "engine.balance.threshold", "1.1").c_str()));
+	EventTrace* trace = openTrace(props, param.boardSizeY);
+	TraceRing* ring = trace ? trace->open("model") : NULL;
+	engine.traceEvents(ring);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	engine.initAgents();
+	engine.run();
+	delete snapshot;
+	if(trace)
+	{
+		trace->close(ring);
+		delete trace;
+	}
+
+	if(!statsFile.empty())
+	{
+		std::ofstream stats(statsFile.c_str());
+		engine.writeStatistics(stats);
+	}
+
+	std::ofstream out(propOr(props, "result.file", "NumberOfHousehold.csv").c_str());
+	engine.writeOutputToFile(out);
+
+	ResultStore* results = openResults(props);
+	if(results)
+	{
+		StoredRun stored;
+		stored.parameters = recordedParameters(props);
+		stored.seeds = laneSeeds(props);
+		stored.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		stored.firstYear = param.startYear;
+		RunResult result;
+		for(int l = 0; l < engine.getLanes(); l++)
+		{
+			result.households.push_back(engine.getHouseholdTrajectory(l));
+			result.capacity.push_back(engine.getCapacityTrajectory(l));
+		}
+		std::vector<double> target = resultTarget(props);
+		stored.fitness = target.empty() ? NAN : trajectoryError(result, target);
+		stored.households = result.households;
+		stored.capacity = result.capacity;
+		results->append(stored);
+		delete results;
+	}
+	return 0;
+}
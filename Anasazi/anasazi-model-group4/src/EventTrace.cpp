@@ -0,0 +1,190 @@
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ByteCodec.h"
+#include "EventTrace.h"
+
+static const char traceMagic[8] = {'A', 'N', 'A', 'T', 'R', 'C', 'E', '1'};
+static const int RING_LOG2 = 14;
+static const int POLL_MS = 10;		//writer wakeups, rings hold 2^RING_LOG2 records meanwhile
+
+TraceRing::TraceRing(int s, const std::string& runLabel, int capacityLog2)
+	: records(1u << capacityLog2), mask((1u << capacityLog2) - 1), head(0), tail(0), finished(false)
+{
+	stream = s;
+	label = runLabel;
+	announced = false;
+}
+
+EventTrace::EventTrace(const std::string& file, int sizeY)
+	: out(file.c_str(), std::ios::binary), closing(false)
+{
+	boardSizeY = sizeY;
+	nextStream = 0;
+	std::string header(traceMagic, sizeof(traceMagic));
+	putInt(header, boardSizeY);
+	out.write(header.data(), header.size());
+	thread = std::thread(&EventTrace::worker, this);
+}
+
+EventTrace::~EventTrace()
+{
+	close();
+}
+
+TraceRing* EventTrace::open(const std::string& label)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	TraceRing* ring = new TraceRing(nextStream++, label, RING_LOG2);
+	rings.push_back(ring);
+	return ring;
+}
+
+void EventTrace::close(TraceRing* ring)
+{
+	ring->finished.store(true, std::memory_order_release);
+}
+
+void EventTrace::close()
+{
+	closing = true;
+	if(thread.joinable())
+	{
+		thread.join();
+	}
+	if(out.is_open())
+	{
+		out.close();
+	}
+}
+
+//appends the ring's pending records to bytes; true if there were any
+bool EventTrace::drain(TraceRing* ring, std::string& bytes)
+{
+	if(!ring->announced)
+	{
+		putInt(bytes, ring->stream);
+		putInt(bytes, (uint32_t)-1);
+		putInt(bytes, ring->label.size());
+		bytes += ring->label;
+		ring->announced = true;
+	}
+	uint32_t t = ring->tail.load(std::memory_order_relaxed);
+	uint32_t h = ring->head.load(std::memory_order_acquire);
+	if(h == t)
+	{
+		return false;
+	}
+	putInt(bytes, ring->stream);
+	putInt(bytes, h - t);
+	for(; t != h; t++)
+	{
+		const TraceEvent& e = ring->records[t & ring->mask];
+		putInt(bytes, e.year);
+		putInt(bytes, (uint16_t)e.lane | (uint32_t)e.type << 16);
+		putInt(bytes, e.household);
+		putInt(bytes, e.cell);
+		putInt(bytes, e.amount);
+	}
+	ring->tail.store(h, std::memory_order_release);
+	return true;
+}
+
+//polls the rings; a ring is freed once its producer has finished and it is empty
+void EventTrace::worker()
+{
+	std::string bytes;
+	std::vector<TraceRing*> active;
+	while(1)
+	{
+		bool stop = closing;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			active = rings;
+		}
+		bool busy = false;
+		std::vector<TraceRing*> done;
+		for(size_t i = 0; i < active.size(); i++)
+		{
+			bool finished = active[i]->finished.load(std::memory_order_acquire);
+			busy |= drain(active[i], bytes);
+			if(finished || stop)
+			{
+				done.push_back(active[i]);
+			}
+		}
+		if(!bytes.empty())
+		{
+			out.write(bytes.data(), bytes.size());
+			bytes.clear();
+		}
+		if(!done.empty())
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for(size_t i = 0; i < done.size(); i++)
+			{
+				rings.erase(std::find(rings.begin(), rings.end(), done[i]));
+				delete done[i];
+			}
+		}
+		if(stop)
+		{
+			return;
+		}
+		if(!busy)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(POLL_MS));
+		}
+	}
+}
+
+bool writeTraceTable(const std::string& traceFile, std::ostream& out)
+{
+	static const char* names[] = {"", "fission", "death", "starvation", "food_shared", "relocation", "move_with_friends"};
+	std::ifstream in(traceFile.c_str(), std::ios::binary);
+	char magic[sizeof(traceMagic)];
+	uint32_t sizeY;
+	if(!in.read(magic, sizeof(magic)) || std::string(magic, sizeof(magic)) != std::string(traceMagic, sizeof(traceMagic)) || !getInt(in, sizeY) || sizeY == 0)
+	{
+		std::cerr << "trace: " << traceFile << " is not an event trace" << std::endl;
+		return false;
+	}
+	std::map<uint32_t, std::string> labels;
+	out << "Run,Year,Lane,Event,Household,X,Y,Amount" << std::endl;
+	uint32_t stream, count;
+	while(getInt(in, stream) && getInt(in, count))
+	{
+		if(count == (uint32_t)-1)
+		{
+			uint32_t length;
+			if(!getInt(in, length))
+			{
+				break;
+			}
+			std::string label(length, ' ');
+			in.read(&label[0], length);
+			labels[stream] = label;
+			continue;
+		}
+		const std::string& label = labels[stream];
+		for(uint32_t i = 0; i < count; i++)
+		{
+			uint32_t year, laneType, household, cell, amount;
+			if(!getInt(in, year) || !getInt(in, laneType) || !getInt(in, household) || !getInt(in, cell) || !getInt(in, amount))
+			{
+				std::cerr << "trace: " << traceFile << " ends inside a chunk" << std::endl;
+				return false;
+			}
+			uint32_t type = laneType >> 16;
+			out << "\"" << label << "\"," << (int32_t)year << "," << (laneType & 0xffff) << ","
+				<< (type < sizeof(names)/sizeof(names[0]) ? names[type] : "unknown") << "," << (int32_t)household << ","
+				<< (int32_t)cell / (int)sizeY << "," << (int32_t)cell % (int)sizeY << "," << (int32_t)amount << "\n";
+		}
+	}
+	return true;
+}
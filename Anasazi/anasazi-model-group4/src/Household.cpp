@@ -12,6 +12,7 @@ Household::Household(repast::AgentId id, int a, int deAge, int mStorage)
 	deathAge = deAge;
 	maizeStorage = mStorage;
 	assignedField = NULL;
+	alive = true;
 }
 
 Household::~Household()
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <vector>
+
+#include "HouseholdSchedule.h"
+
+HouseholdSchedule::HouseholdSchedule(int minFission, int maxFission, int maxDeathAge)
+{
+	reset(minFission, maxFission, maxDeathAge);
+}
+
+//empties the wheel in place, so a reused schedule keeps its buckets' storage
+void HouseholdSchedule::reset(int minFission, int maxFission, int maxDeathAge)
+{
+	minFissionAge = minFission;
+	maxFissionAge = maxFission;
+	//no event lies further ahead than the death age or the end of the fission window, plus one
+	int horizon = std::max(maxDeathAge, maxFissionAge + 1) + 2;
+	int size = 1;
+	while(size <= horizon)
+	{
+		size <<= 1;
+	}
+	wheel.resize(size);
+	for(size_t k = 0; k < wheel.size(); k++)
+	{
+		wheel[k].clear();
+	}
+	mask = size - 1;
+	dying.clear();
+	fertile.clear();
+}
+
+void HouseholdSchedule::grow(int id)
+{
+	if(id >= (int)dying.size())
+	{
+		dying.resize(id + 1, 0);
+		fertile.resize(id + 1, 0);
+	}
+}
+
+void HouseholdSchedule::add(int id, int year, int age, int deathAge)
+{
+	grow(id);
+	update(id, age, deathAge);
+	int thresholds[3] = {deathAge, minFissionAge, maxFissionAge + 1};
+	for(int t = 0; t < 3; t++)
+	{
+		if(thresholds[t] > age)
+		{
+			at(year + thresholds[t] - age, id);
+		}
+	}
+}
+
+//whether the household still gets its own nextYear in this step is not known
+//here, so each threshold is rechecked in both candidate years
+void HouseholdSchedule::extraYear(int id, int year, int age, int deathAge)
+{
+	update(id, age, deathAge);
+	int thresholds[3] = {deathAge, minFissionAge, maxFissionAge + 1};
+	for(int t = 0; t < 3; t++)
+	{
+		if(thresholds[t] > age)
+		{
+			at(year + thresholds[t] - age, id);
+			at(year + thresholds[t] - age + 1, id);
+		}
+	}
+}
+
+void HouseholdSchedule::due(int year, std::vector<int>& ids)
+{
+	std::vector<int>& bucket = wheel[year & mask];
+	ids.insert(ids.end(), bucket.begin(), bucket.end());
+	bucket.clear();
+}
+
+void HouseholdSchedule::update(int id, int age, int deathAge)
+{
+	dying[id] = age >= deathAge;
+	fertile[id] = age >= minFissionAge && age <= maxFissionAge;
+}
+
+void HouseholdSchedule::remove(int id)
+{
+	dying[id] = 0;
+	fertile[id] = 0;
+}
@@ -0,0 +1,317 @@
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "CsvReader.h"
+#include "Landscape.h"
+
+constexpr int Landscape::yieldLevels[5][4];
+const int Landscape::ZONE_BITS;
+const int Landscape::MAIZE_SHIFT;
+const int Landscape::MAIZE_BITS;
+const int Landscape::WATER_BIT;
+const int Landscape::YIELD_ROWS;
+
+Landscape::Landscape(int sizeX, int sizeY)
+{
+	boardSizeX = sizeX;
+	boardSizeY = sizeY;
+	cellCode.assign(sizeX*sizeY, 0);
+	waterBegin.assign(1, 0);
+}
+
+Landscape::~Landscape() {}
+
+//zone names hash to distinct slots with (length + first character) & 15
+static const char* zoneSlotNames[16] = {"Mid", 0, "Kinbiko", "North", 0, "Natural", "Mid Dunes", 0, 0, "North Dunes", "Empty", 0, "Uplands", 0, "General", 0};
+static const int zoneSlotCodes[16] = {MID, 0, KINBIKO, NORTH, 0, NATURAL, MID_DUNES, 0, 0, NORTH_DUNES, EMPTY_ZONE, 0, UPLANDS, 0, GENERAL, 0};
+//maize zone names with (length + 3*first + 3*last character) & 7
+static const char* maizeSlotNames[8] = {"Yield_2", "Sand_dune", 0, "Yield_3", 0, "Yield_1", "No_Yield", "Empty"};
+static const int maizeSlotCodes[8] = {YIELD_2, SAND_DUNE, 0, YIELD_3, 0, YIELD_1, NO_YIELD, EMPTY_MAIZE};
+
+int Landscape::zoneFromName(const char* name)
+{
+	size_t length = strlen(name);
+	if(length == 0)
+	{
+		return UNKNOWN_ZONE;
+	}
+	int slot = (length + (unsigned char)name[0]) & 15;
+	return zoneSlotNames[slot] && strcmp(zoneSlotNames[slot], name) == 0 ? zoneSlotCodes[slot] : UNKNOWN_ZONE;
+}
+
+int Landscape::maizeZoneFromName(const char* name)
+{
+	size_t length = strlen(name);
+	if(length == 0)
+	{
+		return UNKNOWN_MAIZE;
+	}
+	int slot = (length + 3*(unsigned char)name[0] + 3*(unsigned char)name[length - 1]) & 7;
+	return maizeSlotNames[slot] && strcmp(maizeSlotNames[slot], name) == 0 ? maizeSlotCodes[slot] : UNKNOWN_MAIZE;
+}
+
+bool Landscape::readCell(CsvReader& csv, int xField, int& cell)
+{
+	int x, y;
+	if(!csv.getInt(xField, x) || !csv.getInt(xField + 1, y))
+	{
+		return false;
+	}
+	if(x < 0 || x >= boardSizeX || y < 0 || y >= boardSizeY)
+	{
+		return csv.fail("cell " + std::to_string(x) + "," + std::to_string(y) + " is outside the board");
+	}
+	cell = x*boardSizeY + y;
+	return true;
+}
+
+bool Landscape::readCsvMap(const std::string& fileName)
+{
+	//read "x","y","color","zone","maize.zone"
+	CsvReader csv(fileName);
+	csv.next();//Ignore first line
+	int cell;
+	while(!csv.failed() && csv.next())
+	{
+		if(!csv.expect(5) || !readCell(csv, 0, cell))
+		{
+			break;
+		}
+		int z = zoneFromName(csv.field(3));
+		int mz = maizeZoneFromName(csv.field(4));
+		uint8_t& code = cellCode[cell];
+		code = (code & WATER_BIT) | (z == UNKNOWN_ZONE ? ZONE_BITS : z) | ((mz == UNKNOWN_MAIZE ? MAIZE_BITS : mz) << MAIZE_SHIFT);
+	}
+	if(csv.failed())
+	{
+		std::cerr << "landscape: " << csv.getError() << std::endl;
+	}
+	return !csv.failed();
+}
+
+bool Landscape::readCsvWater(const std::string& fileName)
+{
+	//read "id number","meters north","meters east","type","start date","end date","x","y"
+	std::vector<int> cells;
+	std::vector<WaterSource> sources;
+
+	CsvReader csv(fileName);
+	csv.next();//Ignore first line
+	int cell;
+	while(!csv.failed() && csv.next())
+	{
+		WaterSource source;
+		if(!csv.expect(8) || !csv.getInt(3, source.waterType) || !csv.getInt(4, source.startYear)
+			|| !csv.getInt(5, source.endYear) || !readCell(csv, 6, cell))
+		{
+			break;
+		}
+		cells.push_back(cell);
+		sources.push_back(source);
+	}
+	if(csv.failed())
+	{
+		std::cerr << "landscape: " << csv.getError() << std::endl;
+		return false;
+	}
+
+	//bucket the sources per cell, keeping file order within a cell
+	std::vector<int> order(cells.size());
+	for(size_t i = 0; i < order.size(); i++)
+	{
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&cells](int a, int b) {return cells[a] < cells[b]; });
+	waterCells.clear();
+	waterBegin.assign(1, 0);
+	waterSources.clear();
+	for(size_t i = 0; i < order.size(); i++)
+	{
+		int cell = cells[order[i]];
+		if(waterCells.empty() || waterCells.back() != cell)
+		{
+			waterCells.push_back(cell);
+			waterBegin.push_back(waterBegin.back());
+			cellCode[cell] |= WATER_BIT;
+		}
+		waterSources.push_back(sources[order[i]]);
+		waterBegin.back()++;
+	}
+	return true;
+}
+
+bool Landscape::readCsvPdsi(const std::string& fileName, int window)
+{
+	return pdsi.index(fileName, window);
+}
+
+bool Landscape::readCsvHydro(const std::string& fileName, int window)
+{
+	return hydro.index(fileName, window);
+}
+
+//the pdsi column each zone reads; false for zones outside the valley table
+bool Landscape::zonePdsi(int zone, const ClimateRow& p, int& pdsiValue)
+{
+	switch(zone)
+	{
+		case NATURAL:
+			pdsiValue = p.natural;
+			break;
+		case KINBIKO:
+			pdsiValue = p.kinbiko;
+			break;
+		case UPLANDS:
+			pdsiValue = p.upland;
+			break;
+		case NORTH:
+		case NORTH_DUNES:
+			pdsiValue = p.north;
+			break;
+		case GENERAL:
+			pdsiValue = p.general;
+			break;
+		case MID_DUNES:
+		case MID:
+			pdsiValue = p.mid;
+			break;
+		default:
+			return false;
+	}
+	return true;
+}
+
+int Landscape::yieldRow(int pdsiValue)
+{
+	if(pdsiValue < -3) return 0;
+	else if(pdsiValue < -1) return 1;
+	else if(pdsiValue < 1) return 2;
+	else if(pdsiValue < 3) return 3;
+	return 4;
+}
+
+int Landscape::yieldFromRow(int cell, int row) const
+{
+	int z = getZone(cell);
+	int mz = getMaizeZone(cell);
+	if(z < NATURAL || z > MID || mz < YIELD_1 || mz > SAND_DUNE)
+	{
+		return 0;
+	}
+	return yieldLevels[row][mz - YIELD_1];
+}
+
+//same table lookup as AnasaziModel::yieldFromPdsi, including the truncation of the pdsi value to int
+int Landscape::yieldFromPdsi(int cell, const ClimateRow& p) const
+{
+	int pdsiValue;
+	if(!zonePdsi(getZone(cell), p, pdsiValue))
+	{
+		return 0;
+	}
+	return yieldFromRow(cell, yieldRow(pdsiValue));
+}
+
+void Landscape::checkWaterConditions(int year, bool& existStreams, bool& existAlluvium)
+{
+	existStreams = (year >= 280 && year < 360) or (year >= 800 && year < 930) or (year >= 1300 && year < 1450);
+	existAlluvium = ((year >= 420) && (year < 560)) or ((year >= 630) && (year < 680)) or ((year >= 980) && (year < 1120)) or ((year >= 1180) && (year < 1230));
+}
+
+//same rules as Location::checkWater
+bool Landscape::checkWater(int cell, bool existStreams, bool existAlluvium, int year) const
+{
+	if(!hasWaterSource(cell))
+	{
+		return false;
+	}
+	int z = getZone(cell);
+	int x = cell / boardSizeY;
+	int y = cell % boardSizeY;
+	int k = std::lower_bound(waterCells.begin(), waterCells.end(), cell) - waterCells.begin();
+	for(int i = waterBegin[k]; i < waterBegin[k + 1]; i++)
+	{
+		const WaterSource& source = waterSources[i];
+		if(source.waterType == 1)
+		{
+			if(existAlluvium && ((z == GENERAL) or (z == NORTH) or (z == MID) or (z == KINBIKO)))
+			{
+				return true;
+			}
+			else if(existStreams && (z == KINBIKO))
+			{
+				return true;
+			}
+			if (((x==72)&&(y==114))or((x==70)&&(y==113))or((x==69)&&(y==112))or((x==68)&&(y==111))or((x==67)&&(y==110))or((x==66)&&(y==109))or((x==65)&&(y==108))or((x==65)&&(y==107)))
+			{
+				return true;
+			}
+		}
+		else if(source.waterType == 2)
+		{
+			return true;
+		}
+		else if(source.waterType == 3)
+		{
+			if((year >= source.startYear) && (year <= source.endYear))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+//cell x*boardSizeY + y of copy (i, j) is (i*boardSizeX + x)*sizeY + j*boardSizeY + y;
+//the few hard-coded water cells of checkWater stay in the first copy only
+Landscape Landscape::tile(int tilesX, int tilesY) const
+{
+	int sizeY = boardSizeY*tilesY;
+	Landscape board(boardSizeX*tilesX, sizeY);
+	board.pdsi = pdsi;
+	board.hydro = hydro;
+	std::vector<std::pair<int, int> > water;		//board cell, cell of this landscape
+	for(int i = 0; i < tilesX; i++)
+	{
+		for(int x = 0; x < boardSizeX; x++)
+		{
+			for(int j = 0; j < tilesY; j++)
+			{
+				int row = (i*boardSizeX + x)*sizeY + j*boardSizeY;
+				std::copy(&cellCode[x*boardSizeY], &cellCode[x*boardSizeY] + boardSizeY, &board.cellCode[row]);
+			}
+		}
+	}
+	for(size_t k = 0; k < waterCells.size(); k++)
+	{
+		int x = waterCells[k] / boardSizeY, y = waterCells[k] % boardSizeY;
+		for(int i = 0; i < tilesX; i++)
+		{
+			for(int j = 0; j < tilesY; j++)
+			{
+				water.push_back(std::make_pair((i*boardSizeX + x)*sizeY + j*boardSizeY + y, (int)k));
+			}
+		}
+	}
+	std::sort(water.begin(), water.end());
+	for(size_t w = 0; w < water.size(); w++)
+	{
+		int k = water[w].second;
+		board.waterCells.push_back(water[w].first);
+		board.waterSources.insert(board.waterSources.end(), waterSources.begin() + waterBegin[k], waterSources.begin() + waterBegin[k + 1]);
+		board.waterBegin.push_back(board.waterSources.size());
+	}
+	return board;
+}
+
+void Landscape::memoryReport(std::ostream& out) const
+{
+	double n = getCellCount();
+	size_t cellBytes = cellCode.capacity()*sizeof(uint8_t);
+	size_t waterBytes = waterCells.capacity()*sizeof(int) + waterBegin.capacity()*sizeof(int) + waterSources.capacity()*sizeof(WaterSource);
+	out << "landscape.cells," << cellBytes << "," << cellBytes/n << "\n";
+	out << "landscape.water.sources," << waterBytes << "," << waterBytes/n << "\n";
+}
@@ -0,0 +1,15 @@
+#include <iostream>
+#include <string>
+
+#include "Drivers.h"
+
+/* Repast-free front-end: lite.exe props/model.props [key=value ...] */
+int main(int argc, char** argv){
+	if(argc < 2)
+	{
+		std::cerr << "usage: " << argv[0] << " <model.props> [key=value ...]" << std::endl;
+		return 1;
+	}
+	std::string propsFile = argv[1]; // The name of the properties file
+	return runEngine(readProperties(propsFile, argc - 2, argv + 2));
+}
@@ -0,0 +1,1752 @@
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/math/distributions/normal.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_int.hpp>
+#include <boost/random/uniform_real.hpp>
+
+#include "LockstepEngine.h"
+
+constexpr double LockstepEngine::SOIL_MIN;
+constexpr double LockstepEngine::SOIL_STEP;
+const int LockstepEngine::NOISE_BLOCK;
+
+static int propToInt(const std::map<std::string, std::string>& props, const std::string& key)
+{
+	std::map<std::string, std::string>::const_iterator it = props.find(key);
+	return it == props.end() ? 0 : atoi(it->second.c_str());
+}
+
+static double propToDouble(const std::map<std::string, std::string>& props, const std::string& key)
+{
+	std::map<std::string, std::string>::const_iterator it = props.find(key);
+	return it == props.end() ? 0 : atof(it->second.c_str());
+}
+
+EngineParameters EngineParameters::fromProperties(const std::map<std::string, std::string>& props)
+{
+	EngineParameters p;
+	p.boardSizeX = propToInt(props, "board.size.x");
+	p.boardSizeY = propToInt(props, "board.size.y");
+	p.countOfAgents = propToInt(props, "count.of.agents");
+	p.startYear = propToInt(props, "start.year");
+	p.endYear = propToInt(props, "end.year");
+	p.maxStorageYear = propToInt(props, "max.store.year");
+	p.maxStorage = propToInt(props, "max.storage");
+	p.householdNeed = propToInt(props, "household.need");
+	p.minFissionAge = propToInt(props, "min.fission.age");
+	p.maxFissionAge = propToInt(props, "max.fission.age");
+	p.minDeathAge = propToInt(props, "min.death.age");
+	p.maxDeathAge = propToInt(props, "max.death.age");
+	p.maxDistance = propToInt(props, "max.distance");
+	p.initMinCorn = propToInt(props, "initial.min.corn");
+	p.initMaxCorn = propToInt(props, "initial.max.corn");
+	p.annualVariance = propToDouble(props, "annual.variance");
+	p.spatialVariance = propToDouble(props, "spatial.variance");
+	p.fertilityProbability = propToDouble(props, "fertility.prop");
+	p.harvestAdjustment = propToDouble(props, "harvest.adj");
+	p.maizeStorageRatio = propToDouble(props, "new.household.ini.maize");
+	p.thresholdSharefood = propToDouble(props, "threshold.sharefood");
+	p.b1 = propToDouble(props, "B1");
+	p.b3 = propToDouble(props, "B3");
+	p.b4 = propToDouble(props, "B4");
+	std::map<std::string, std::string>::const_iterator features = props.find("engine.features");
+	p.features = features == props.end() ? (unsigned int)ALL_FEATURES : parseFeatures(features->second);
+	std::map<std::string, std::string>::const_iterator packed = props.find("engine.soil.packed");
+	p.packedSoil = packed != props.end() && packed->second == "true";
+	std::map<std::string, std::string>::const_iterator lazy = props.find("engine.yield.lazy");
+	p.lazyYield = lazy != props.end() && lazy->second == "true";
+	return p;
+}
+
+unsigned int EngineParameters::parseFeatures(const std::string& list)
+{
+	unsigned int features = 0;
+	size_t begin = 0;
+	while(begin <= list.size())
+	{
+		size_t end = list.find(',', begin);
+		if(end == std::string::npos) end = list.size();
+		std::string name = list.substr(begin, end - begin);
+		name.erase(0, name.find_first_not_of(" \t"));
+		name.erase(name.find_last_not_of(" \t") + 1);
+		if(name == "all") features |= ALL_FEATURES;
+		else if(name == "sharing") features |= FOOD_SHARING;
+		else if(name == "friends") features |= MOVE_WITH_FRIENDS;
+		else if(name == "network") features |= SOCIAL_NETWORK;
+		else if(name == "closeness") features |= CLOSENESS;
+		begin = end + 1;
+	}
+	return features;
+}
+
+struct LockstepEngine::LaneWorkers
+{
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable start;
+	std::condition_variable done;
+	int generation;		//ticks handed out so far
+	int running;		//workers still stepping this tick
+	bool stop;
+};
+
+LockstepEngine::LockstepEngine(const Landscape* land, const EngineParameters& p, const std::vector<unsigned int>& seeds)
+	: pdsi(&land->getPdsi())
+{
+	landscape = land;
+	cells = landscape->getCellCount();
+	workers = NULL;
+	balanceThreshold = 1;
+	reset(p, seeds);
+}
+
+//every buffer is refilled with assign/clear, which keep their storage, so a reset
+//allocates only what the new run needs beyond the largest run so far
+void LockstepEngine::reset(const EngineParameters& p, const std::vector<unsigned int>& seeds)
+{
+	if(pending.valid())
+	{
+		pending.wait();
+	}
+	param = p;
+	year = param.startYear;
+	stopAt = param.endYear - param.startYear + 1;
+	lanes = seeds.size();
+	snapshot = NULL;
+	snapshotEvery = 1;
+	shownState.clear();
+	trace = NULL;
+	std::fill_n(phaseSeconds, (int)PHASES, 0.0);
+	rebalances = 0;
+	laneStats.clear();
+	statsAgeBin = 1;
+	scenarios = NULL;
+	firstScenario = 0;
+	climateYear = nextClimateYear = param.startYear - 2;
+
+	water.assign(cells, 0);
+	if(param.lazyYield)
+	{
+		yieldLevel.assign(ZONE_GROUPS*lanes, 0);
+		harvestYear.assign(cells*lanes, -1);
+		yearShift.assign(lanes, 0);
+		yieldNoise.clear();
+	}
+	else
+	{
+		yieldLevel.assign(cells*lanes, 0);
+		yieldNoise.assign(NOISE_BLOCK*lanes, 0);
+		harvestYear.clear();
+		yearShift.clear();
+		capacityArcs.clear();
+	}
+	if(param.packedSoil)
+	{
+		soilCode.assign(cells*lanes, 0);
+		soilQuality.clear();
+	}
+	else
+	{
+		soilQuality.assign(cells*lanes, 0);
+		soilCode.clear();
+	}
+	expectedHarvest.assign(cells*lanes, 0);
+	state.assign(cells*lanes, 0);
+	if(!nextWater.empty())
+	{
+		lookAhead();
+	}
+	if(workers)
+	{
+		int groups = groupStart.size() - 1;
+		for(int g = 0; g <= groups; g++)
+		{
+			groupStart[g] = (int)((long)lanes*g/groups);
+		}
+	}
+
+	laneData.resize(lanes);
+	laneSchedule.resize(lanes, HouseholdSchedule(param.minFissionAge, param.maxFissionAge, param.maxDeathAge));
+	for(int l = 0; l < lanes; l++)
+	{
+		laneSchedule[l].reset(param.minFissionAge, param.maxFissionAge, param.maxDeathAge);
+		Lane& lane = laneData[l];
+		lane.seed = seeds[l];
+		lane.rng.seed(seeds[l]);
+		lane.contactRng.seed(seeds[l] ^ 0x9e3779b9u);
+		lane.houseID = 0;
+		lane.maxCapacity = 0;
+		lane.closenessPasses = 0;
+		lane.Relocateflag = false;
+		lane.households.resize(0);
+		lane.slotOfId.clear();
+		lane.occupants.clear();
+		lane.contacts.clear();
+		lane.searchCursor.clear();
+		lane.dueIds.clear();
+		lane.hungry.clear();
+		lane.work = 0;
+		lane.load = 0;
+		lane.dirtyCells.clear();
+		lane.outYear.clear();
+		lane.outHouseholds.clear();
+		lane.outCapacity.clear();
+		if(param.features & SOCIAL_NETWORK)
+		{
+			initnetwork(l);
+		}
+	}
+}
+
+LockstepEngine::~LockstepEngine()
+{
+	if(pending.valid())
+	{
+		pending.wait();
+	}
+	if(workers)
+	{
+		{
+			std::lock_guard<std::mutex> lock(workers->mutex);
+			workers->stop = true;
+		}
+		workers->start.notify_all();
+		for(size_t t = 0; t < workers->threads.size(); t++)
+		{
+			workers->threads[t].join();
+		}
+		delete workers;
+	}
+}
+
+void LockstepEngine::initAgents()
+{
+	int sizeX = landscape->getBoardSizeX();
+	int sizeY = landscape->getBoardSizeY();
+
+	//scenario lanes share one seed, so lane 0's draws are copied instead of repeated
+	int drawn = scenarios ? 1 : lanes;
+	for(int l = 0; l < drawn; l++)
+	{
+		Lane& lane = laneData[l];
+		boost::normal_distribution<> soilGen(0, param.spatialVariance);
+		for(int c = 0; c < cells; c++)
+		{
+			setSoil(at(c, l), 1 + soilGen(lane.rng));
+		}
+
+		boost::uniform_int<> initAgeGen(0, param.minDeathAge);
+		boost::uniform_int<> initMaizeGen(param.initMinCorn, param.initMaxCorn);
+		boost::uniform_int<> deathAgeGen(param.minDeathAge, param.maxDeathAge);
+		boost::uniform_int<> xGen(0, sizeX-1);
+		boost::uniform_int<> yGen(0, sizeY-1);
+		for(int i = 0; i < param.countOfAgents; i++)
+		{
+			int initAge = initAgeGen(lane.rng);
+			int mStorage = initMaizeGen(lane.rng);
+			int slot = newHousehold(l, initAge, deathAgeGen(lane.rng), mStorage);
+			int cell;
+			do
+			{
+				int x = xGen(lane.rng);
+				int y = yGen(lane.rng);
+				cell = x*sizeY + y;
+			} while(state[at(cell, l)] == 2);
+			placeHousehold(l, slot, cell);
+			setState(cell, l, 1);
+		}
+		if(param.features & CLOSENESS)
+		{
+			updateCloseness(l);
+		}
+	}
+	for(int l = drawn; l < lanes; l++)
+	{
+		copyLane(0, l);
+	}
+	if(param.lazyYield)
+	{
+		buildCapacityArcs();
+	}
+
+	updateLocationProperties();
+
+	for(int l = 0; l < lanes; l++)
+	{
+		Lane& lane = laneData[l];
+		HouseholdStore& h = lane.households;
+		int n = h.size();
+		for(int s = 0; s < n; s++)
+		{
+			if(!h.alive[s])
+			{
+				continue;
+			}
+			if(h.age[s] >= h.deathAge[s])
+			{
+				TRACE_EVENT(trace, year, l, TRACE_DEATH, h.id[s], h.cell[s], h.age[s]);
+				freeCell(l, h.cell[s]);
+				leaveCell(l, s);
+				dropHousehold(l, s);
+			}
+			else
+			{
+				fieldSearch(l, s);
+			}
+		}
+		compactHouseholds(l);
+	}
+}
+
+void LockstepEngine::doPerTick()
+{
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+	updateLocationProperties();
+	Clock::time_point landscapeDone = Clock::now();
+	for(int l = 0; l < lanes; l++)
+	{
+		Lane& lane = laneData[l];
+		lane.outYear.push_back(year);
+		lane.outHouseholds.push_back(lane.households.size());
+		lane.outCapacity.push_back(lane.maxCapacity);
+		if(!laneStats.empty())
+		{
+			laneStats[l].record(year);
+		}
+	}
+	if(snapshot && (year - param.startYear) % snapshotEvery == 0)
+	{
+		for(int l = 0; l < lanes; l++)
+		{
+			takeSnapshot(l);
+		}
+	}
+	year++;
+	Clock::time_point outputDone = Clock::now();
+	if(workers && !trace)
+	{
+		rebalanceLanes();
+		{
+			std::lock_guard<std::mutex> lock(workers->mutex);
+			workers->running = workers->threads.size();
+			workers->generation++;
+		}
+		workers->start.notify_all();
+		stepLaneGroup(0);
+		std::unique_lock<std::mutex> lock(workers->mutex);
+		workers->done.wait(lock, [this]() {return workers->running == 0; });
+	}
+	else
+	{
+		HouseholdStep step = householdSteps[param.features & ALL_FEATURES];
+		for(int l = 0; l < lanes; l++)
+		{
+			(this->*step)(l);
+		}
+	}
+	phaseSeconds[PHASE_LANDSCAPE] += std::chrono::duration<double>(landscapeDone - start).count();
+	phaseSeconds[PHASE_OUTPUT] += std::chrono::duration<double>(outputDone - landscapeDone).count();
+	phaseSeconds[PHASE_HOUSEHOLDS] += std::chrono::duration<double>(Clock::now() - outputDone).count();
+}
+
+void LockstepEngine::stepLanesOn(int threads, double imbalance)
+{
+	int groups = std::min(threads, lanes);
+	if(workers || groups < 2)
+	{
+		return;
+	}
+	balanceThreshold = std::max(1.0, imbalance);
+	groupStart.resize(groups + 1);
+	for(int g = 0; g <= groups; g++)
+	{
+		groupStart[g] = (int)((long)lanes*g/groups);
+	}
+	workers = new LaneWorkers();
+	workers->generation = 0;
+	workers->running = 0;
+	workers->stop = false;
+	for(int g = 1; g < groups; g++)
+	{
+		workers->threads.push_back(std::thread(&LockstepEngine::laneWorker, this, g));
+	}
+}
+
+void LockstepEngine::stepLaneGroup(int g)
+{
+	HouseholdStep step = householdSteps[param.features & ALL_FEATURES];
+	for(int l = groupStart[g]; l < groupStart[g + 1]; l++)
+	{
+		(this->*step)(l);
+	}
+}
+
+void LockstepEngine::laneWorker(int g)
+{
+	int seen = 0;
+	while(1)
+	{
+		{
+			std::unique_lock<std::mutex> lock(workers->mutex);
+			workers->start.wait(lock, [&]() {return workers->stop || workers->generation != seen; });
+			if(workers->stop)
+			{
+				return;
+			}
+			seen = workers->generation;
+		}
+		stepLaneGroup(g);
+		std::lock_guard<std::mutex> lock(workers->mutex);
+		if(--workers->running == 0)
+		{
+			workers->done.notify_one();
+		}
+	}
+}
+
+static double busiestGroup(const std::vector<double>& prefix, const std::vector<int>& groupStart)
+{
+	double busiest = 0;
+	for(size_t g = 0; g + 1 < groupStart.size(); g++)
+	{
+		busiest = std::max(busiest, prefix[groupStart[g + 1]] - prefix[groupStart[g]]);
+	}
+	return busiest;
+}
+
+//a lane's load is its work averaged over the last steps, as searches come in bursts;
+//groups are split again once the busiest one is balanceThreshold times the mean,
+//and the new split is kept only if it relieves the busiest group
+void LockstepEngine::rebalanceLanes()
+{
+	int groups = groupStart.size() - 1;
+	std::vector<double> prefix(lanes + 1, 0);
+	for(int l = 0; l < lanes; l++)
+	{
+		Lane& lane = laneData[l];
+		lane.load = 0.75*lane.load + 0.25*(lane.work + 1);
+		prefix[l + 1] = prefix[l] + lane.load;
+	}
+	double busiest = busiestGroup(prefix, groupStart);
+	if(busiest <= balanceThreshold*prefix[lanes]/groups)
+	{
+		return;
+	}
+	std::vector<int> previous(groupStart);
+	bisectLanes(prefix, 0, lanes, 0, groups);
+	if(busiestGroup(prefix, groupStart) < busiest)
+	{
+		rebalances++;
+	}
+	else
+	{
+		groupStart.swap(previous);
+	}
+}
+
+//splits lanes lo..hi-1 between groups g0..g1-1 in proportion to their counts,
+//leaving every group at least one lane
+void LockstepEngine::bisectLanes(const std::vector<double>& prefix, int lo, int hi, int g0, int g1)
+{
+	if(g1 - g0 < 2)
+	{
+		return;
+	}
+	int gm = (g0 + g1)/2;
+	double target = prefix[lo] + (prefix[hi] - prefix[lo])*(gm - g0)/(g1 - g0);
+	int m = lo + (gm - g0);
+	while(m < hi - (g1 - gm) && prefix[m + 1] <= target)
+	{
+		m++;
+	}
+	if(m < hi - (g1 - gm) && target - prefix[m] > prefix[m + 1] - target)
+	{
+		m++;
+	}
+	groupStart[gm] = m;
+	bisectLanes(prefix, lo, m, g0, gm);
+	bisectLanes(prefix, m, hi, gm, g1);
+}
+
+void LockstepEngine::run()
+{
+	for(int tick = 0; tick < stopAt; tick++)
+	{
+		doPerTick();
+	}
+}
+
+void LockstepEngine::recordSnapshots(SnapshotWriter* writer, int every)
+{
+	snapshot = writer;
+	snapshotEvery = std::max(1, every);
+	//the writer starts from empty maps, so cells already occupied are changes
+	shownState.assign(cells*lanes, 0);
+	for(int c = 0; c < cells; c++)
+	{
+		for(int l = 0; l < lanes; l++)
+		{
+			if(state[at(c, l)] != 0)
+			{
+				shownState[at(c, l)] = SHOWN_DIRTY;
+				laneData[l].dirtyCells.push_back(c);
+			}
+		}
+	}
+}
+
+//households are kept in creation order, so the frame is already sorted by id; only
+//the cells written since the last frame are compared, so a frame costs the lane's
+//activity rather than the map
+void LockstepEngine::takeSnapshot(int l)
+{
+	Lane& lane = laneData[l];
+	SnapshotFrame frame;
+	frame.year = year;
+	frame.lane = l;
+	std::sort(lane.dirtyCells.begin(), lane.dirtyCells.end());
+	for(size_t k = 0; k < lane.dirtyCells.size(); k++)
+	{
+		int c = lane.dirtyCells[k];
+		signed char& shown = shownState[at(c, l)];
+		shown &= ~SHOWN_DIRTY;
+		if(shown != state[at(c, l)])
+		{
+			shown = state[at(c, l)];
+			SnapshotCell cell = {c, shown};
+			frame.changedCells.push_back(cell);
+		}
+	}
+	lane.dirtyCells.clear();
+	const HouseholdStore& store = lane.households;
+	frame.households.resize(store.size());
+	for(int s = 0; s < store.size(); s++)
+	{
+		SnapshotHousehold& h = frame.households[s];
+		h.id = store.id[s];
+		h.cell = store.cell[s];
+		h.field = store.field[s];
+		h.maizeStorage = store.maizeStorage[s];
+		h.age = store.age[s];
+	}
+	snapshot->write(frame);
+}
+
+void LockstepEngine::collectStatistics(int ageBinWidth)
+{
+	statsAgeBin = ageBinWidth;
+	laneStats.assign(lanes, PopulationStats(param.maxDeathAge, ageBinWidth));
+}
+
+void LockstepEngine::setSoil(int i, double value)
+{
+	if(soilCode.empty())
+	{
+		soilQuality[i] = value;
+		return;
+	}
+	double code = floor((value - SOIL_MIN)/SOIL_STEP + 0.5);
+	soilCode[i] = (uint16_t)std::min(std::max(code, 0.0), 65535.0);
+}
+
+static uint64_t mix64(uint64_t x)
+{
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+uint32_t LockstepEngine::cellShift(int l, int cell) const
+{
+	return mix64(((uint64_t)laneData[l].seed << 32) | (uint32_t)cell) >> 32;
+}
+
+static uint32_t yearShiftOf(unsigned int seed, int year)
+{
+	return mix64((((uint64_t)seed << 32) | (uint32_t)year) ^ 0xd1b54a32d192ed03ULL) >> 32;
+}
+
+//the N(0, annualVariance) noise at the 32-bit fraction v
+double LockstepEngine::noiseAt(uint32_t v) const
+{
+	if(param.annualVariance <= 0)
+	{
+		return 0;
+	}
+	return param.annualVariance*boost::math::quantile(boost::math::normal(), (v + 0.5)/4294967296.0);
+}
+
+void LockstepEngine::lazyHarvest(int cell, int l)
+{
+	int i = at(cell, l);
+	int z = landscape->getZone(cell);
+	int row = yieldLevel[(z < ZONE_GROUPS ? z : 0)*lanes + l];
+	double baseYield = landscape->yieldFromRow(cell, row) * soilAt(i) * param.harvestAdjustment;
+	expectedHarvest[i] = baseYield*(1 + noiseAt(cellShift(l, cell) + yearShift[l]));
+	harvestYear[i] = climateYear - param.startYear;
+}
+
+int LockstepEngine::CapacityArcs::count(uint32_t shift) const
+{
+	return always + wrapping + (std::upper_bound(starts.begin(), starts.end(), shift) - starts.begin())
+		- (std::upper_bound(ends.begin(), ends.end(), shift) - ends.begin());
+}
+
+//the harvest is monotone in the noise fraction, so the fractions that feed a
+//household are a prefix or a suffix; its first value is estimated from the normal
+//cdf and then moved to where lazyHarvest's own arithmetic crosses householdNeed
+void LockstepEngine::buildCapacityArcs()
+{
+	const int rows = Landscape::YIELD_ROWS;
+	const int need = param.householdNeed;
+	capacityArcs.assign(lanes*ZONE_GROUPS*rows, CapacityArcs());
+	for(int l = 0; l < lanes; l++)
+	{
+		for(int c = 0; c < cells; c++)
+		{
+			int z = landscape->getZone(c);
+			z = z < ZONE_GROUPS ? z : 0;
+			double soil = soilAt(at(c, l));
+			uint32_t r = cellShift(l, c);
+			for(int row = 0; row < rows; row++)
+			{
+				CapacityArcs& arcs = capacityArcs[(l*ZONE_GROUPS + z)*rows + row];
+				double baseYield = landscape->yieldFromRow(c, row) * soil * param.harvestAdjustment;
+				bool low = (int)(baseYield*(1 + noiseAt(0))) >= need;
+				bool high = (int)(baseYield*(1 + noiseAt(UINT32_MAX))) >= need;
+				if(low == high)
+				{
+					arcs.always += low;
+					continue;
+				}
+				auto crossed = [&](uint32_t v) {return ((int)(baseYield*(1 + noiseAt(v))) >= need) == high; };
+				uint32_t v = 0;
+				if(baseYield != 0 && param.annualVariance > 0)
+				{
+					double p = boost::math::cdf(boost::math::normal(), (need/baseYield - 1)/param.annualVariance);
+					v = std::min(std::max(p*4294967296.0 - 0.5, 0.0), 4294967295.0);
+				}
+				while(v > 0 && crossed(v - 1))
+				{
+					v--;
+				}
+				while(!crossed(v))
+				{
+					v++;
+				}
+				//fractions [v, 2^32) or [0, v), as year shifts
+				uint32_t start = (high ? v : 0) - r;
+				uint32_t end = (high ? 0 : v) - r;
+				arcs.starts.push_back(start);
+				arcs.ends.push_back(end);
+				arcs.wrapping += end < start;
+			}
+		}
+	}
+	for(size_t k = 0; k < capacityArcs.size(); k++)
+	{
+		std::sort(capacityArcs[k].starts.begin(), capacityArcs[k].starts.end());
+		std::sort(capacityArcs[k].ends.begin(), capacityArcs[k].ends.end());
+	}
+}
+
+void LockstepEngine::memoryReport(std::ostream& out) const
+{
+	double n = cells;
+	size_t perLane = yieldNoise.capacity()*sizeof(double) + yieldLevel.capacity()*sizeof(int16_t) + soilQuality.capacity()*sizeof(double) + soilCode.capacity()*sizeof(uint16_t)
+		+ expectedHarvest.capacity()*sizeof(int) + (state.capacity() + shownState.capacity())*sizeof(signed char);
+	perLane += nextYieldLevel.capacity()*sizeof(int16_t) + harvestYear.capacity()*sizeof(int32_t);
+	for(size_t k = 0; k < capacityArcs.size(); k++)
+	{
+		perLane += sizeof(CapacityArcs) + (capacityArcs[k].starts.capacity() + capacityArcs[k].ends.capacity())*sizeof(uint32_t);
+	}
+	size_t shared = (water.capacity() + nextWater.capacity())*sizeof(char);
+	size_t households = 0;
+	for(int l = 0; l < lanes; l++)
+	{
+		const Lane& lane = laneData[l];
+		const HouseholdStore& h = lane.households;
+		households += h.id.capacity()*6*sizeof(int) + h.alive.capacity() + h.closenessMap.capacity()*sizeof(std::map<int, Tie>)
+			+ lane.slotOfId.capacity()*sizeof(int) + lane.occupants.bucket_count()*sizeof(void*);
+		std::unordered_map<int, std::vector<int> >::const_iterator it = lane.occupants.begin();
+		for(; it != lane.occupants.end(); ++it)
+		{
+			households += sizeof(*it) + sizeof(void*) + it->second.capacity()*sizeof(int);
+		}
+	}
+	out << "engine.cells.shared," << shared << "," << shared/n << "\n";
+	out << "engine.cells.lanes," << perLane << "," << perLane/n << "\n";
+	out << "engine.households," << households << "," << households/n << "\n";
+}
+
+void LockstepEngine::useClimateScenarios(const ClimateEnsemble* ensemble, int first)
+{
+	scenarios = ensemble;
+	firstScenario = first;
+}
+
+//random stream, population and cell state; only the seed label stays
+void LockstepEngine::copyLane(int from, int to)
+{
+	unsigned int seed = laneData[to].seed;
+	laneData[to] = laneData[from];
+	laneData[to].seed = seed;
+	laneData[to].dirtyCells.clear();
+	laneSchedule[to] = laneSchedule[from];
+	if(!laneStats.empty())
+	{
+		laneStats[to] = laneStats[from];
+	}
+	for(int c = 0; c < cells; c++)
+	{
+		setSoil(at(c, to), soilAt(at(c, from)));
+		setState(c, to, state[at(c, from)]);
+	}
+}
+
+int LockstepEngine::getHouseholdCount(int lane) const
+{
+	return laneData[lane].households.size();
+}
+
+//a single lane is written like AnasaziModel's result file, several lanes get a Seed column
+void LockstepEngine::writeOutputToFile(std::ostream& out) const
+{
+	if(lanes == 1)
+	{
+		const Lane& lane = laneData[0];
+		out << "Year,Number-of-Households,maxCapacity" << std::endl;
+		for(size_t t = 0; t < lane.outYear.size(); t++)
+		{
+			out << lane.outYear[t] << "," << lane.outHouseholds[t] << "," << lane.outCapacity[t] << "\n";
+		}
+		out.flush();
+		return;
+	}
+	out << "Seed,Year,Number-of-Households,maxCapacity" << std::endl;
+	for(int l = 0; l < lanes; l++)
+	{
+		const Lane& lane = laneData[l];
+		for(size_t t = 0; t < lane.outYear.size(); t++)
+		{
+			out << lane.seed << "," << lane.outYear[t] << "," << lane.outHouseholds[t] << "," << lane.outCapacity[t] << "\n";
+		}
+	}
+	out.flush();
+}
+
+void LockstepEngine::writeStatistics(std::ostream& out) const
+{
+	PopulationStats::writeHeader(out, param.maxDeathAge, statsAgeBin, lanes > 1);
+	for(size_t l = 0; l < laneStats.size(); l++)
+	{
+		laneStats[l].write(out, lanes > 1 ? std::to_string(laneData[l].seed) + "," : "");
+	}
+	out.flush();
+}
+
+//water and yield levels of forYear; they depend on the year alone, not on the households
+void LockstepEngine::computeClimate(int forYear, std::vector<char>& waterOut, std::vector<int16_t>& yieldOut)
+{
+	bool existStreams, existAlluvium;
+	Landscape::checkWaterConditions(forYear, existStreams, existAlluvium);
+
+	//water is shared by every lane, and so is the climate unless lanes run scenarios
+	for(int c = 0; c < cells; c++)
+	{
+		waterOut[c] = landscape->checkWater(c, existStreams, existAlluvium, forYear);
+	}
+	if(param.lazyYield)
+	{
+		for(int l = 0; l < lanes; l++)
+		{
+			ClimateRow climate = scenarios ? scenarios->row(firstScenario + l, forYear) : pdsi.at(forYear);
+			for(int z = 0; z < ZONE_GROUPS; z++)
+			{
+				int pdsiValue;
+				yieldOut[z*lanes + l] = Landscape::zonePdsi(z, climate, pdsiValue) ? Landscape::yieldRow(pdsiValue) : 0;
+			}
+		}
+		return;
+	}
+	if(scenarios)
+	{
+		for(int l = 0; l < lanes; l++)
+		{
+			ClimateRow climate = scenarios->row(firstScenario + l, forYear);
+			for(int c = 0; c < cells; c++)
+			{
+				yieldOut[at(c, l)] = landscape->yieldFromPdsi(c, climate);
+			}
+		}
+	}
+	else
+	{
+		const ClimateRow& climate = pdsi.at(forYear);
+		for(int c = 0; c < cells; c++)
+		{
+			std::fill_n(&yieldOut[c*lanes], lanes, landscape->yieldFromPdsi(c, climate));
+		}
+	}
+}
+
+//brings water and yieldLevel to the current year, from the look-ahead buffers when they
+//hold it, and with look-ahead on starts next year's rasters for the household step to overlap
+void LockstepEngine::updateClimate()
+{
+	if(pending.valid())
+	{
+		pending.get();
+	}
+	if(climateYear != year && nextClimateYear == year)
+	{
+		water.swap(nextWater);
+		yieldLevel.swap(nextYieldLevel);
+		std::swap(climateYear, nextClimateYear);
+	}
+	if(climateYear != year)
+	{
+		computeClimate(year, water, yieldLevel);
+		climateYear = year;
+	}
+	if(!nextWater.empty() && nextClimateYear != year + 1)
+	{
+		nextClimateYear = year + 1;
+		pending = std::async(std::launch::async, &LockstepEngine::computeClimate, this, year + 1, std::ref(nextWater), std::ref(nextYieldLevel));
+	}
+}
+
+void LockstepEngine::lookAhead()
+{
+	nextWater.assign(water.size(), 0);
+	nextYieldLevel.assign(yieldLevel.size(), 0);
+}
+
+void LockstepEngine::updateLocationProperties()
+{
+	updateClimate();
+	if(param.lazyYield)
+	{
+		for(int l = 0; l < lanes; l++)
+		{
+			yearShift[l] = yearShiftOf(laneData[l].seed, year);
+			int capacity = 0;
+			for(int z = 0; z < ZONE_GROUPS; z++)
+			{
+				capacity += capacityArcs[(l*ZONE_GROUPS + z)*Landscape::YIELD_ROWS + yieldLevel[z*lanes + l]].count(yearShift[l]);
+			}
+			laneData[l].maxCapacity = capacity;
+		}
+		return;
+	}
+
+	//noise is drawn per lane in cell order, like AnasaziModel's single yieldGen; the
+	//lanes' streams are independent, so it is drawn a block of cells at a time and
+	//only the block is kept, then one pass over the block updates every lane
+	std::vector<boost::normal_distribution<> > yieldGen(lanes, boost::normal_distribution<>(0, param.annualVariance));
+	std::vector<int> allHarvest(lanes, 0);
+	int* capacity = &allHarvest[0];
+	double* noise = &yieldNoise[0];
+	const double harvestAdjustment = param.harvestAdjustment;
+	const int householdNeed = param.householdNeed;
+	const int K = lanes;
+	for(int block = 0; block < cells; block += NOISE_BLOCK)
+	{
+		int n = std::min(NOISE_BLOCK, cells - block);
+		for(int l = 0; l < K; l++)
+		{
+			boost::mt19937& rng = laneData[l].rng;
+			for(int j = 0; j < n; j++)
+			{
+				noise[j*K + l] = yieldGen[l](rng);
+			}
+		}
+		for(int j = 0; j < n; j++)
+		{
+			int c = block + j;
+			const int16_t* y = &yieldLevel[c*K];
+			const double* e = &noise[j*K];
+			int* harvest = &expectedHarvest[c*K];
+			if(soilCode.empty())
+			{
+				const double* soil = &soilQuality[c*K];
+				for(int l = 0; l < K; l++)
+				{
+					double baseYield = y[l] * soil[l] * harvestAdjustment;
+					harvest[l] = baseYield*(1+e[l]);
+					capacity[l] += (harvest[l] >= householdNeed);
+				}
+			}
+			else
+			{
+				const uint16_t* soil = &soilCode[c*K];
+				for(int l = 0; l < K; l++)
+				{
+					double baseYield = y[l] * (SOIL_MIN + soil[l]*SOIL_STEP) * harvestAdjustment;
+					harvest[l] = baseYield*(1+e[l]);
+					capacity[l] += (harvest[l] >= householdNeed);
+				}
+			}
+		}
+	}
+	for(int l = 0; l < lanes; l++)
+	{
+		laneData[l].maxCapacity = allHarvest[l];
+	}
+}
+
+template<unsigned int F>
+void LockstepEngine::updateHouseholdProperties(int l)
+{
+	Lane& lane = laneData[l];
+	HouseholdStore& h = lane.households;
+	boost::uniform_real<> fissionGen(0, 1);
+	boost::uniform_int<> deathAgeGen(param.minDeathAge, param.maxDeathAge);
+
+	lane.searchCursor.clear();
+	HouseholdSchedule& schedule = laneSchedule[l];
+	std::vector<int>& dueIds = lane.dueIds;
+	std::vector<char>& hungry = lane.hungry;
+	dueIds.clear();
+	schedule.due(year, dueIds);
+	for(size_t i = 0; i < dueIds.size(); i++)
+	{
+		int slot = lane.slotOfId[dueIds[i]];
+		if(slot >= 0)
+		{
+			schedule.update(dueIds[i], h.age[slot], h.deathAge[slot]);
+		}
+	}
+
+	//households born during this tick are not visited until the next one
+	int n = h.size();
+	lane.work = n;
+	const int need = param.householdNeed;
+
+	//without food sharing or moving with friends no household changes another's
+	//storage or field, so hunger is decided in one pass before the loop and the
+	//yearly storage update is one pass after it
+	const bool batched = !(F & (FOOD_SHARING | MOVE_WITH_FRIENDS));
+	if(batched && n > 0)
+	{
+		hungry.resize(n);
+		const int* field = &h.field[0];
+		const int* storage = &h.maizeStorage[0];
+		char* isHungry = &hungry[0];
+		for(int s = 0; s < n; s++)
+		{
+			isHungry[s] = harvestAt(field[s], l) + storage[s] <= need;
+		}
+	}
+
+	for(int s = 0; s < n; s++)
+	{
+		if(!h.alive[s])
+		{
+			continue;
+		}
+		if(schedule.isDying(h.id[s]))
+		{
+			TRACE_EVENT(trace, year, l, TRACE_DEATH, h.id[s], h.cell[s], h.age[s]);
+			removeHousehold(l, s);
+			continue;
+		}
+
+		//as in AnasaziModel, the fission draw is only taken inside the fission window
+		if(schedule.isFertile(h.id[s]) && fissionGen(lane.rng) <= param.fertilityProbability)
+		{
+			int percentage = param.maizeStorageRatio;
+			int mStorage = h.maizeStorage[s] * percentage;
+			addMaize(l, s, -mStorage);
+			if(batched)
+			{
+				hungry[s] = !checkMaize(l, s);
+			}
+			int parentCell = h.cell[s];
+			int childId = lane.houseID;
+			int child = newHousehold(l, 0, deathAgeGen(lane.rng), mStorage);
+			placeHousehold(l, child, parentCell);
+			TRACE_EVENT(trace, year, l, TRACE_FISSION, h.id[s], parentCell, mStorage);
+			fieldSearch(l, child);
+			if(F & SOCIAL_NETWORK)
+			{
+				addNewAgentContacts(l, childId);
+			}
+		}
+
+		bool fieldFound = true;
+		int locgoal = -1;
+		if(batched ? hungry[s] : !checkMaize(l, s))
+		{
+			if((F & FOOD_SHARING) && ShareFood(l, s))
+			{
+				if(!laneStats.empty())
+				{
+					laneStats[l].fedBySharing();
+				}
+			}
+			else
+			{
+				locgoal = h.cell[s];
+				fieldFound = fieldSearch(l, s);
+			}
+		}
+		if(fieldFound)
+		{
+			if((F & MOVE_WITH_FRIENDS) && lane.Relocateflag)
+			{
+				MovewithFriends(l, locgoal, s);
+			}
+			if(!batched)
+			{
+				addMaize(l, s, harvestAt(h.field[s], l) - need);
+			}
+		}
+	}
+
+	//every household still alive among the first n was fed this year and ages by
+	//one; nothing reads the age of a household after its own turn in the step
+	if(batched)
+	{
+		if(!laneStats.empty())
+		{
+			for(int s = 0; s < n; s++)
+			{
+				if(h.alive[s])
+				{
+					laneStats[l].changeStorage(h.maizeStorage[s], h.maizeStorage[s] + harvestAt(h.field[s], l) - need);
+				}
+			}
+		}
+		for(int s = 0; s < n; s++)
+		{
+			if(h.alive[s])
+			{
+				h.maizeStorage[s] += harvestAt(h.field[s], l) - need;
+			}
+		}
+	}
+	if(!laneStats.empty())
+	{
+		for(int s = 0; s < n; s++)
+		{
+			if(h.alive[s])
+			{
+				laneStats[l].ageHousehold(h.age[s]);
+			}
+		}
+	}
+	int* age = n > 0 ? &h.age[0] : NULL;
+	const char* alive = n > 0 ? &h.alive[0] : NULL;
+	for(int s = 0; s < n; s++)
+	{
+		age[s] += alive[s];
+	}
+
+	if(F & CLOSENESS)
+	{
+		updateCloseness(l);
+	}
+	compactHouseholds(l);
+}
+
+const LockstepEngine::HouseholdStep LockstepEngine::householdSteps[ALL_FEATURES + 1] = {
+	&LockstepEngine::updateHouseholdProperties<0>, &LockstepEngine::updateHouseholdProperties<1>,
+	&LockstepEngine::updateHouseholdProperties<2>, &LockstepEngine::updateHouseholdProperties<3>,
+	&LockstepEngine::updateHouseholdProperties<4>, &LockstepEngine::updateHouseholdProperties<5>,
+	&LockstepEngine::updateHouseholdProperties<6>, &LockstepEngine::updateHouseholdProperties<7>,
+	&LockstepEngine::updateHouseholdProperties<8>, &LockstepEngine::updateHouseholdProperties<9>,
+	&LockstepEngine::updateHouseholdProperties<10>, &LockstepEngine::updateHouseholdProperties<11>,
+	&LockstepEngine::updateHouseholdProperties<12>, &LockstepEngine::updateHouseholdProperties<13>,
+	&LockstepEngine::updateHouseholdProperties<14>, &LockstepEngine::updateHouseholdProperties<15>
+};
+
+int LockstepEngine::firstFreeField(int l, int x0, int y0, int range)
+{
+	//cells at exactly Chebyshev distance range, in the x-major order of Moore2DGridQuery
+	int sizeX = landscape->getBoardSizeX();
+	int sizeY = landscape->getBoardSizeY();
+	int minX = std::max(0, x0 - range), maxX = std::min(sizeX - 1, x0 + range);
+	int minY = std::max(0, y0 - range), maxY = std::min(sizeY - 1, y0 + range);
+	for(int x = minX; x <= maxX; x++)
+	{
+		bool edge = (x == x0 - range) || (x == x0 + range);
+		int step = edge ? 1 : 2*range;
+		for(int y = edge ? minY : y0 - range; y <= maxY; y += step)
+		{
+			if(y < minY)
+			{
+				continue;
+			}
+			int c = x*sizeY + y;
+			if(state[at(c, l)] == 0 && harvestAt(c, l) >= param.householdNeed)
+			{
+				return c;
+			}
+		}
+	}
+	return -1;
+}
+
+//firstFreeField over widening rings up to sizeY, and the ring it stopped at. Rings
+//below the origin's cursor are skipped: they held no free productive cell when
+//last scanned this tick, and freeCell lowers the cursor when one is freed there.
+//Origins without a cursor start at ring 1, so searches ending there add none
+int LockstepEngine::searchField(int l, int origin, int& range)
+{
+	std::unordered_map<int, int>& cursors = laneData[l].searchCursor;
+	int sizeY = landscape->getBoardSizeY();
+	std::unordered_map<int, int>::iterator cursor = cursors.empty() ? cursors.end() : cursors.find(origin);
+	int found = -1;
+	for(range = cursor == cursors.end() ? 1 : cursor->second; range <= sizeY; range++)
+	{
+		if((found = firstFreeField(l, origin / sizeY, origin % sizeY, range)) >= 0)
+		{
+			break;
+		}
+	}
+	int first = cursor == cursors.end() ? 1 : cursor->second;
+	laneData[l].work += (2*range + 1)*(2*range + 1) - (2*first - 1)*(2*first - 1);
+	if(cursor != cursors.end())
+	{
+		cursor->second = range;
+	}
+	else if(range > 1)
+	{
+		cursors[origin] = range;
+	}
+	return found;
+}
+
+void LockstepEngine::freeCell(int l, int cell)
+{
+	int i = at(cell, l);
+	if(state[i] == 0)
+	{
+		return;
+	}
+	setState(cell, l, 0);
+	Lane& lane = laneData[l];
+	if(lane.searchCursor.empty() || harvestAt(cell, l) < param.householdNeed)
+	{
+		return;
+	}
+	int sizeY = landscape->getBoardSizeY();
+	int x = cell / sizeY, y = cell % sizeY;
+	std::unordered_map<int, int>::iterator it = lane.searchCursor.begin();
+	for(; it != lane.searchCursor.end(); ++it)
+	{
+		int d = std::max(abs(x - it->first / sizeY), abs(y - it->first % sizeY));
+		if(d > 0 && d < it->second)
+		{
+			it->second = d;
+		}
+	}
+}
+
+bool LockstepEngine::fieldSearch(int l, int slot)
+{
+	Lane& lane = laneData[l];
+	int range;
+	int found = searchField(l, lane.households.cell[slot], range);
+	if(found < 0)
+	{
+		TRACE_EVENT(trace, year, l, TRACE_STARVATION, lane.households.id[slot], lane.households.cell[slot], 0);
+		removeHousehold(l, slot);
+		lane.Relocateflag = false;
+		return false;
+	}
+	chooseField(l, slot, found);
+	if(range >= 10)
+	{
+		return relocateHousehold(l, slot);
+	}
+	lane.Relocateflag = false;
+	return true;
+}
+
+void LockstepEngine::removeHousehold(int l, int slot)
+{
+	Lane& lane = laneData[l];
+	int cell = lane.households.cell[slot];
+	if(occupantsOf(l, cell).size() == 1)
+	{
+		freeCell(l, cell);
+	}
+	//AnasaziModel::removeHousehold appends the field to locationList and then
+	//resets locationList[0], which is still the dwelling, so the field stays claimed
+	if(lane.households.field[slot] >= 0)
+	{
+		freeCell(l, cell);
+	}
+	leaveCell(l, slot);
+	dropHousehold(l, slot);
+}
+
+bool LockstepEngine::relocateHousehold(int l, int slot)
+{
+	Lane& lane = laneData[l];
+	int sizeX = landscape->getBoardSizeX();
+	int sizeY = landscape->getBoardSizeY();
+	int home = lane.households.cell[slot];
+	int field = lane.households.field[slot];
+	int fx = field / sizeY, fy = field % sizeY;
+	int homeYield = harvestAt(home, l);
+	int range = floor(param.maxDistance/100);
+
+	//candidates in first-seen order: the dwelling, then each widening square around the field
+	std::vector<int> suitableLocations;
+	std::vector<int> waterSources;
+	if(state[at(home, l)] != 2 && water[home])
+	{
+		waterSources.push_back(home);
+	}
+	int i = 1;
+	int searched = 0;
+	while(1)
+	{
+		int r = range*i;
+		for(int x = std::max(0, fx - r); x <= std::min(sizeX - 1, fx + r); x++)
+		{
+			for(int y = std::max(0, fy - r); y <= std::min(sizeY - 1, fy + r); y++)
+			{
+				int d = std::max(abs(x - fx), abs(y - fy));
+				int c = x*sizeY + y;
+				if(d == 0 || d <= searched || c == home || state[at(c, l)] == 2)
+				{
+					continue;
+				}
+				if(homeYield < harvestAt(c, l))
+				{
+					suitableLocations.push_back(c);
+				}
+				if(water[c])
+				{
+					waterSources.push_back(c);
+				}
+			}
+		}
+		if(!suitableLocations.empty() && !waterSources.empty())
+		{
+			break;
+		}
+		searched = r;
+		i++;
+		if(range*i > sizeY)
+		{
+			TRACE_EVENT(trace, year, l, TRACE_STARVATION, lane.households.id[slot], home, 0);
+			removeHousehold(l, slot);
+			lane.Relocateflag = false;
+			return false;
+		}
+	}
+
+	int target = suitableLocations[0];
+	if(suitableLocations.size() > 1)
+	{
+		double minDistance = 0;
+		bool first = true;
+		for(size_t s = 0; s < suitableLocations.size(); s++)
+		{
+			int sx = suitableLocations[s] / sizeY, sy = suitableLocations[s] % sizeY;
+			for(size_t w = 0; w < waterSources.size(); w++)
+			{
+				int wx = waterSources[w] / sizeY, wy = waterSources[w] % sizeY;
+				double distance = sqrt(pow((sx-wx),2) + pow((sy-wy),2));
+				if(first || distance < minDistance)
+				{
+					minDistance = distance;
+					target = suitableLocations[s];
+					first = false;
+				}
+			}
+		}
+	}
+	TRACE_EVENT(trace, year, l, TRACE_RELOCATION, lane.households.id[slot], target,
+			std::max(abs(target / sizeY - home / sizeY), abs(target % sizeY - home % sizeY)));
+	if(param.features & CLOSENESS)
+	{
+		settleTies(l, slot);
+	}
+	leaveCell(l, slot);
+	placeHousehold(l, slot, target);
+	lane.Relocateflag = true;
+	if(!laneStats.empty())
+	{
+		laneStats[l].relocated();
+	}
+	return true;
+}
+
+//AnasaziModel::updateCloseness visits every pair; here only co-residents are, in
+//the same slot order, since they alone may draw a first closeness from the lane's
+//stream. Everyone else's ties catch up in settleTie
+void LockstepEngine::updateCloseness(int l)
+{
+	Lane& lane = laneData[l];
+	HouseholdStore& h = lane.households;
+	int pass = ++lane.closenessPasses;
+	std::vector<int> mates;
+	for(int i = 0; i < h.size(); i++)
+	{
+		if(!h.alive[i] || h.field[i] < 0)
+		{
+			continue;
+		}
+		const std::vector<int>& ids = occupantsOf(l, h.cell[i]);
+		if(ids.size() < 2)
+		{
+			continue;
+		}
+		mates.clear();
+		for(size_t k = 0; k < ids.size(); k++)
+		{
+			int j = lane.slotOfId[ids[k]];
+			if(j != i && h.alive[j] && h.field[j] >= 0)
+			{
+				mates.push_back(j);
+			}
+		}
+		std::sort(mates.begin(), mates.end());
+		std::map<int, Tie>& closenessMap = h.closenessMap[i];
+		for(size_t k = 0; k < mates.size(); k++)
+		{
+			int j = mates[k];
+			std::map<int, Tie>::iterator it = closenessMap.find(h.id[j]);
+			if(it != closenessMap.end())
+			{
+				settleTie(l, i, j, it->second, pass - 1);
+			}
+			if(it == closenessMap.end() || it->second.value == -1)
+			{
+				boost::normal_distribution<> Closeness(0.5, 0.1);
+				Tie tie = {Closeness(lane.rng), pass};
+				closenessMap[h.id[j]] = tie;
+			}
+			else
+			{
+				it->second.value = it->second.value + 0.01;
+				it->second.pass = pass;
+			}
+		}
+	}
+}
+
+//replays the updateCloseness passes after tie.pass up to passes; they all saw the
+//dwellings and fields of now, and dead households take no part
+void LockstepEngine::settleTie(int l, int slot, int other, Tie& tie, int passes)
+{
+	int pending = passes - tie.pass;
+	tie.pass = passes;
+	const HouseholdStore& h = laneData[l].households;
+	if(pending <= 0 || other < 0 || !h.alive[slot] || !h.alive[other] || h.field[slot] < 0 || h.field[other] < 0)
+	{
+		return;
+	}
+	if(h.cell[slot] == h.cell[other])
+	{
+		for(; pending > 0; pending--)
+		{
+			tie.value = tie.value + 0.01;
+		}
+		return;
+	}
+	int sizeY = landscape->getBoardSizeY();
+	int dx = h.cell[slot] / sizeY - h.cell[other] / sizeY;
+	int dy = h.cell[slot] % sizeY - h.cell[other] % sizeY;
+	double distance = sqrt(pow(dx,2) + pow(dy,2));
+	for(; pending > 0 && tie.value != -1; pending--)
+	{
+		tie.value = tie.value - 0.0001 * distance;
+	}
+}
+
+//brings every tie to and from the household up to date before it changes dwelling
+//or gets its first field
+void LockstepEngine::settleTies(int l, int slot)
+{
+	Lane& lane = laneData[l];
+	HouseholdStore& h = lane.households;
+	std::map<int, Tie>& own = h.closenessMap[slot];
+	for(std::map<int, Tie>::iterator it = own.begin(); it != own.end(); ++it)
+	{
+		settleTie(l, slot, lane.slotOfId[it->first], it->second, lane.closenessPasses);
+	}
+	for(int s = 0; s < h.size(); s++)
+	{
+		if(s == slot || !h.alive[s] || h.closenessMap[s].empty())
+		{
+			continue;
+		}
+		std::map<int, Tie>::iterator it = h.closenessMap[s].find(h.id[slot]);
+		if(it != h.closenessMap[s].end())
+		{
+			settleTie(l, s, slot, it->second, lane.closenessPasses);
+		}
+	}
+}
+
+bool LockstepEngine::ShareFood(int l, int slot)
+{
+	Lane& lane = laneData[l];
+	int householdId = lane.households.id[slot];
+	std::vector<int> householdList(occupantsOf(l, lane.households.cell[slot]));
+	std::vector<int> tempHouseholdList;
+	int addedMaize = 0;
+	bool ShareSucflag = false;
+	bool Liveflag = false;
+
+	std::vector<std::pair<double, int> > byCloseness;
+	for(size_t i = 0; i < householdList.size(); i++)
+	{
+		byCloseness.push_back(std::make_pair(getCloseness(l, lane.slotOfId[householdList[i]], householdId), householdList[i]));
+	}
+	std::sort(byCloseness.begin(), byCloseness.end(),
+		[](const std::pair<double, int>& a, const std::pair<double, int>& b) {
+			return a.first < b.first;
+	});
+
+	for(size_t i = 0; i < byCloseness.size(); i++)
+	{
+		int temp = lane.slotOfId[byCloseness[i].second];
+		//as in AnasaziModel::ShareFood the connection is checked for the household with itself
+		if(getCloseness(l, slot, lane.households.id[temp]) >= param.thresholdSharefood && checkConnection(l, householdId, householdId))
+		{
+			if(checkMaize(l, temp))
+			{
+				int loanMaize = getlackMaize(l, temp);
+				if(getlackMaize(l, slot) <= loanMaize)
+				{
+					TRACE_EVENT(trace, year, l, TRACE_FOOD_SHARED, householdId, lane.households.cell[slot], getlackMaize(l, slot));
+					addMaize(l, slot, getlackMaize(l, slot));
+					addMaize(l, temp, -getlackMaize(l, slot));
+					setCloseness(l, temp, householdId, getCloseness(l, temp, householdId) + 0.05);
+					return true;
+				}
+				else
+				{
+					tempHouseholdList.push_back(temp);
+					addedMaize += getlackMaize(l, temp);
+					if(addedMaize >= getlackMaize(l, slot))
+					{
+						ShareSucflag = true;
+						addedMaize = 0;
+						Liveflag = true;
+						break;
+					}
+				}
+			}
+		}
+	}
+	if(ShareSucflag)
+	{
+		for(size_t i = 0; i < tempHouseholdList.size(); i++)
+		{
+			int temp = tempHouseholdList[i];
+			TRACE_EVENT(trace, year, l, TRACE_FOOD_SHARED, householdId, lane.households.cell[slot],
+					addedMaize + getlackMaize(l, temp) < getlackMaize(l, slot) ? getlackMaize(l, temp) : getlackMaize(l, slot));
+			addedMaize += getlackMaize(l, temp);
+			setCloseness(l, temp, householdId, getCloseness(l, temp, householdId) + 0.05);
+			if(addedMaize < getlackMaize(l, slot))
+			{
+				int loan = getlackMaize(l, temp);
+				addMaize(l, slot, loan);
+				addMaize(l, temp, -loan);
+			}
+			else
+			{
+				addMaize(l, slot, getlackMaize(l, slot));
+				addMaize(l, temp, -getlackMaize(l, slot));
+				return true;
+			}
+		}
+	}
+	return Liveflag;
+}
+
+bool LockstepEngine::MovewithFriends(int l, int locgoal, int slot)
+{
+	Lane& lane = laneData[l];
+	if(locgoal < 0)
+	{
+		return false;
+	}
+	std::vector<int> householdList(occupantsOf(l, locgoal));
+	boost::uniform_real<> pfmTemp(0, 1);
+	for(size_t i = 0; i < householdList.size(); i++)
+	{
+		int temp = lane.slotOfId[householdList[i]];
+		double pfm = ((getCloseness(l, slot, householdList[i])-(param.thresholdSharefood +0.1))/(1 - (param.thresholdSharefood +0.1)));
+		if(pfmTemp(lane.rng) >= pfm)
+		{
+			int range;
+			int found = searchField(l, locgoal, range);
+			if(found < 0)
+			{
+				return false;
+			}
+			if(range >= 10)
+			{
+				return false;
+			}
+			chooseField(l, temp, found);
+			TRACE_EVENT(trace, year, l, TRACE_MOVE_WITH_FRIENDS, lane.households.id[temp], found, lane.households.id[slot]);
+			nextYear(l, temp);
+			laneSchedule[l].extraYear(lane.households.id[temp], year, lane.households.age[temp], lane.households.deathAge[temp]);
+			return true;
+		}
+	}
+	return false;
+}
+
+int LockstepEngine::newHousehold(int l, int age, int deathAge, int mStorage)
+{
+	Lane& lane = laneData[l];
+	int id = lane.houseID++;
+	int slot = lane.households.add(id, age, deathAge, mStorage);
+	lane.slotOfId.push_back(slot);
+	laneSchedule[l].add(id, year + 1, age, deathAge);
+	if(!laneStats.empty())
+	{
+		laneStats[l].addHousehold(age, mStorage);
+	}
+	return slot;
+}
+
+//marks the household dead; compactHouseholds drops it from the lane
+void LockstepEngine::dropHousehold(int l, int slot)
+{
+	HouseholdStore& h = laneData[l].households;
+	h.alive[slot] = false;
+	laneData[l].slotOfId[h.id[slot]] = -1;
+	laneSchedule[l].remove(h.id[slot]);
+	if(!laneStats.empty())
+	{
+		laneStats[l].removeHousehold(h.age[slot], h.maizeStorage[slot]);
+	}
+}
+
+const std::vector<int>& LockstepEngine::occupantsOf(int l, int cell) const
+{
+	static const std::vector<int> none;
+	std::unordered_map<int, std::vector<int> >::const_iterator it = laneData[l].occupants.find(cell);
+	return it == laneData[l].occupants.end() ? none : it->second;
+}
+
+void LockstepEngine::placeHousehold(int l, int slot, int cell)
+{
+	Lane& lane = laneData[l];
+	lane.households.cell[slot] = cell;
+	lane.occupants[cell].push_back(lane.households.id[slot]);
+	if(!laneStats.empty())
+	{
+		laneStats[l].enterZone(landscape->getZone(cell));
+	}
+}
+
+void LockstepEngine::leaveCell(int l, int slot)
+{
+	Lane& lane = laneData[l];
+	int cell = lane.households.cell[slot];
+	std::unordered_map<int, std::vector<int> >::iterator it = lane.occupants.find(cell);
+	std::vector<int>& list = it->second;
+	list.erase(std::find(list.begin(), list.end(), lane.households.id[slot]));
+	if(list.empty())
+	{
+		lane.occupants.erase(it);
+	}
+	if(!laneStats.empty())
+	{
+		laneStats[l].leaveZone(landscape->getZone(cell));
+	}
+}
+
+void LockstepEngine::compactHouseholds(int l)
+{
+	Lane& lane = laneData[l];
+	HouseholdStore& h = lane.households;
+	std::vector<int> dead;
+	int kept = 0;
+	for(int s = 0; s < h.size(); s++)
+	{
+		if(h.alive[s])
+		{
+			if(kept != s)
+			{
+				h.move(s, kept);
+			}
+			lane.slotOfId[h.id[kept]] = kept;
+			kept++;
+		}
+		else
+		{
+			dead.push_back(h.id[s]);
+		}
+	}
+	h.resize(kept);
+	//ids are never reused, so closeness to a removed household is dead weight
+	if(!dead.empty() && (param.features & CLOSENESS))
+	{
+		for(int s = 0; s < kept; s++)
+		{
+			std::map<int, Tie>& closenessMap = h.closenessMap[s];
+			for(size_t d = 0; d < dead.size() && !closenessMap.empty(); d++)
+			{
+				closenessMap.erase(dead[d]);
+			}
+		}
+	}
+}
+
+int LockstepEngine::HouseholdStore::add(int householdId, int a, int dAge, int mStorage)
+{
+	id.push_back(householdId);
+	cell.push_back(-1);
+	field.push_back(-1);
+	maizeStorage.push_back(mStorage);
+	age.push_back(a);
+	deathAge.push_back(dAge);
+	alive.push_back(true);
+	closenessMap.push_back(std::map<int, Tie>());
+	return id.size() - 1;
+}
+
+//overwrites slot to with slot from, which is left to be cut off by resize
+void LockstepEngine::HouseholdStore::move(int from, int to)
+{
+	id[to] = id[from];
+	cell[to] = cell[from];
+	field[to] = field[from];
+	maizeStorage[to] = maizeStorage[from];
+	age[to] = age[from];
+	deathAge[to] = deathAge[from];
+	alive[to] = alive[from];
+	closenessMap[to].swap(closenessMap[from]);
+}
+
+void LockstepEngine::HouseholdStore::resize(int n)
+{
+	id.resize(n);
+	cell.resize(n);
+	field.resize(n);
+	maizeStorage.resize(n);
+	age.resize(n);
+	deathAge.resize(n);
+	alive.resize(n);
+	closenessMap.resize(n);
+}
+
+void LockstepEngine::chooseField(int l, int slot, int cell)
+{
+	int& field = laneData[l].households.field[slot];
+	if(field < 0 && (param.features & CLOSENESS))
+	{
+		settleTies(l, slot);
+	}
+	if(field >= 0)
+	{
+		freeCell(l, field);
+	}
+	setState(cell, l, 2);
+	field = cell;
+}
+
+//only MovewithFriends ages a household on the spot; the household step ages everyone in one pass
+void LockstepEngine::nextYear(int l, int slot)
+{
+	HouseholdStore& h = laneData[l].households;
+	if(!laneStats.empty())
+	{
+		laneStats[l].ageHousehold(h.age[slot]);
+	}
+	h.age[slot]++;
+	addMaize(l, slot, harvestAt(h.field[slot], l) - param.householdNeed);
+}
+
+void LockstepEngine::addMaize(int l, int slot, int amount)
+{
+	int& maizeStorage = laneData[l].households.maizeStorage[slot];
+	if(!laneStats.empty())
+	{
+		laneStats[l].changeStorage(maizeStorage, maizeStorage + amount);
+	}
+	maizeStorage += amount;
+}
+
+bool LockstepEngine::checkMaize(int l, int slot)
+{
+	const HouseholdStore& h = laneData[l].households;
+	return (harvestAt(h.field[slot], l) + h.maizeStorage[slot]) > param.householdNeed;
+}
+
+//also the amount a household can lend (Household::getLoanMaize)
+int LockstepEngine::getlackMaize(int l, int slot)
+{
+	const HouseholdStore& h = laneData[l].households;
+	return harvestAt(h.field[slot], l) + h.maizeStorage[slot] - param.householdNeed;
+}
+
+double LockstepEngine::getCloseness(int l, int slot, int otherId)
+{
+	Lane& lane = laneData[l];
+	std::map<int, Tie>& closenessMap = lane.households.closenessMap[slot];
+	std::map<int, Tie>::iterator it = closenessMap.find(otherId);
+	if(it == closenessMap.end())
+	{
+		return -1.0;
+	}
+	settleTie(l, slot, lane.slotOfId[otherId], it->second, lane.closenessPasses);
+	return it->second.value;
+}
+
+void LockstepEngine::setCloseness(int l, int slot, int otherId, double value)
+{
+	Tie tie = {value, laneData[l].closenessPasses};
+	laneData[l].households.closenessMap[slot][otherId] = tie;
+}
+
+//contacts are drawn like the model's rand() < Probability, from the lane's own
+//contact stream so lanes stepped on several threads stay deterministic
+void LockstepEngine::initnetwork(int l)
+{
+	Lane& lane = laneData[l];
+	boost::uniform_int<> contactGen(0, RAND_MAX);
+	for (int i = 0; i < param.countOfAgents; i++){
+		for (int j = i + 1; j < param.countOfAgents; j++){
+			if (contactGen(lane.contactRng) < Probability){
+				lane.contacts.insert(std::make_pair(i, j));
+				lane.contacts.insert(std::make_pair(j, i));
+			}
+		}
+	}
+}
+
+void LockstepEngine::addNewAgentContacts(int l, int agentId)
+{
+	Lane& lane = laneData[l];
+	boost::uniform_int<> contactGen(0, RAND_MAX);
+	for(int i = 0; i < agentId; i++){
+		if(contactGen(lane.contactRng) < Probability){
+			lane.contacts.insert(std::make_pair(agentId, i));
+			lane.contacts.insert(std::make_pair(i, agentId));
+		}
+	}
+}
+
+bool LockstepEngine::checkConnection(int l, int id1, int id2)
+{
+	const Lane& lane = laneData[l];
+	return lane.contacts.count(std::make_pair(id1, id2)) && lane.contacts.count(std::make_pair(id2, id1));
+}
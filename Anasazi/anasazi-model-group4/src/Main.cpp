@@ -1,12 +1,29 @@
 #include <boost/mpi.hpp>
 #include "repast_hpc/RepastProcess.h"
+#include "repast_hpc/Properties.h"
+#include "repast_hpc/Utilities.h"
 
 #include "Model.h"
 #include "Location.h"
 #include "Household.h"
+#include "Drivers.h"
+#include "LockstepEngine.h"
 #include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
 
 
+static PropertyMap toPropertyMap(repast::Properties& props)
+{
+	PropertyMap values;
+	for(repast::Properties::key_iterator it = props.keys_begin(); it != props.keys_end(); ++it)
+	{
+		values[*it] = props.getProperty(*it);
+	}
+	return values;
+}
+
 int main(int argc, char** argv){
 
 
@@ -17,13 +34,55 @@ int main(int argc, char** argv){
 
 	repast::RepastProcess::init(configFile);
 	world = new boost::mpi::communicator;
+
+	repast::Properties props(propsFile, argc, argv, world);
+	std::string lanes = props.getProperty("replicate.lanes");
+	std::string mode = props.getProperty("run.mode");
+	if(!mode.empty() && mode != "model")
+	{
+		int status = runEngine(toPropertyMap(props));
+		repast::RepastProcess::instance()->done();
+		return status;
+	}
+
+	//lanes, reduced feature sets, snapshots and statistics exist only in the lockstep
+	//engine, whose runs follow the model's rules but not its agent order, so they
+	//agree with the model in distribution only; they need run.mode = engine
+	std::string features = props.getProperty("engine.features");
+	std::vector<std::string> engineOnly;
+	if(!lanes.empty() && repast::strToInt(lanes) > 1) engineOnly.push_back("replicate.lanes");
+	if(!features.empty() && EngineParameters::parseFeatures(features) != ALL_FEATURES) engineOnly.push_back("engine.features");
+	if(!props.getProperty("snapshot.file").empty()) engineOnly.push_back("snapshot.file");
+	if(!props.getProperty("stats.file").empty()) engineOnly.push_back("stats.file");
+	if(!engineOnly.empty())
+	{
+		if(world->rank() == 0)
+		{
+			std::cerr << "main.exe: the Repast model (run.mode = model) does not support";
+			for(size_t i = 0; i < engineOnly.size(); i++)
+			{
+				std::cerr << (i ? ", " : " ") << engineOnly[i];
+			}
+			std::cerr << "; set run.mode = engine to run the lockstep engine instead" << std::endl;
+		}
+		repast::RepastProcess::instance()->done();
+		return 1;
+	}
+
 	AnasaziModel* model = new AnasaziModel(propsFile, argc, argv, world);
 	repast::ScheduleRunner& runner = repast::RepastProcess::instance()->getScheduleRunner();
 
-	model->initAgents();
+	if(!model->initAgents())
+	{
+		delete model;
+		repast::RepastProcess::instance()->done();
+		return 1;
+	}
 	model->initSchedule(runner);
 
 	runner.run();
+	model->writeTiming();
+	model->storeResult();
 	delete model;
 	repast::RepastProcess::instance()->done();
 }
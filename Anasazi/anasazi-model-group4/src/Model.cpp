@@ -1,6 +1,9 @@
 #include <stdio.h>
 #include <vector>
+#include <algorithm>
+#include <chrono>
 #include <boost/mpi.hpp>
+#include <boost/serialization/vector.hpp>
 #include "repast_hpc/AgentId.h"
 #include "repast_hpc/RepastProcess.h"
 #include "repast_hpc/Utilities.h"
@@ -15,10 +18,14 @@
 #include "repast_hpc/GridComponents.h"
 #include <string>
 #include <fstream>
+#include <iostream>
 #include <stdlib.h>
 #include "repast_hpc/Moore2DGridQuery.h"
 
 #include "Model.h"
+#include "CsvReader.h"
+#include "Landscape.h"
+#include "ResultStore.h"
 
 // substracts b<T> to a<T>
 template <typename T>
@@ -50,6 +57,8 @@ void substract_vector(std::vector<T>& a, const std::vector<T>& b)
 AnasaziModel::AnasaziModel(std::string propsFile, int argc, char** argv, boost::mpi::communicator* comm): context(comm) , locationContext(comm)
 {
 	props = new repast::Properties(propsFile, argc, argv, comm);
+	world = comm;
+	std::fill_n(phaseSeconds, TIMING_PHASES, 0.0);
 	boardSizeX = repast::strToInt(props->getProperty("board.size.x"));
 	boardSizeY = repast::strToInt(props->getProperty("board.size.y"));
 
@@ -102,6 +111,9 @@ AnasaziModel::AnasaziModel(std::string propsFile, int argc, char** argv, boost::
 	soilGen = new repast::NormalGenerator(repast::Random::instance()->createNormalGenerator(0,param.spatialVariance));
 	initAgeGen = new repast::IntUniformGenerator(repast::Random::instance()->createUniIntGenerator(0,param.minDeathAge));
 	initMaizeGen = new repast::IntUniformGenerator(repast::Random::instance()->createUniIntGenerator(param.initMinCorn,param.initMaxCorn));
+	schedule = new HouseholdSchedule(param.minFissionAge, param.maxFissionAge, param.maxDeathAge);
+	pdsi = NULL;
+	hydro = NULL;
 
 	Agent_Number = 14; //Number of initial agents
 	std::vector<std::vector<int>> adjacencyMatrix(Agent_Number, std::vector<int>(Agent_Number, 0));
@@ -115,10 +127,13 @@ AnasaziModel::AnasaziModel(std::string propsFile, int argc, char** argv, boost::
 AnasaziModel::~AnasaziModel()
 {
 	delete props;
+	delete schedule;
+	delete pdsi;
+	delete hydro;
 	out.close();
 }
 
-void AnasaziModel::initAgents()
+bool AnasaziModel::initAgents()
 {
 	int rank = repast::RepastProcess::instance()->rank();
 
@@ -135,10 +150,10 @@ void AnasaziModel::initAgents()
 		}
 	}
 
-	readCsvMap();
-	readCsvWater();
-	readCsvPdsi();
-	readCsvHydro();
+	if(!readCsvMap() || !readCsvWater() || !readCsvPdsi() || !readCsvHydro())
+	{
+		return false;
+	}
 	int noOfAgents  = repast::strToInt(props->getProperty("count.of.agents"));
 	repast::IntUniformGenerator xGen = repast::IntUniformGenerator(repast::Random::instance()->createUniIntGenerator(0,boardSizeX-1));
 	repast::IntUniformGenerator yGen = repast::IntUniformGenerator(repast::Random::instance()->createUniIntGenerator(0,boardSizeY-1));
@@ -147,8 +162,10 @@ void AnasaziModel::initAgents()
 		repast::AgentId id(houseID, rank, 2);
 		int initAge = initAgeGen->next();
 		int mStorage = initMaizeGen->next();
-		Household* agent = new Household(id, initAge, deathAgeGen->next(), mStorage);
+		int deathAge = deathAgeGen->next();
+		Household* agent = new Household(id, initAge, deathAge, mStorage);
 		context.addAgent(agent);
+		schedule->add(houseID, year + 1, initAge, deathAge);
 		std::vector<Location*> locationList;
 
 		newLocation:
@@ -174,14 +191,16 @@ void AnasaziModel::initAgents()
 	repast::SharedContext<Household>::const_iterator local_agents_iter = context.begin();
 	repast::SharedContext<Household>::const_iterator local_agents_end = context.end();
 
-	while(local_agents_iter != local_agents_end)
+	for(; local_agents_iter != local_agents_end; local_agents_iter++)
 	{
 		Household* household = (&**local_agents_iter);
+		if(!household->isAlive())
+		{
+			continue;
+		}
 		if(household->death())
 		{
 			repast::AgentId id = household->getId();
-			local_agents_iter++;
-
 			std::vector<int> loc;
 			householdSpace->getLocation(id, loc);
 
@@ -191,267 +210,223 @@ void AnasaziModel::initAgents()
 				locationSpace->getObjectsAt(repast::Point<int>(loc[0], loc[1]), locationList);
 				locationList[0]->setState(0);
 			}
-			context.removeAgent(id);
+			household->markRemoved();
+			schedule->remove(id.id());
+			removedHouseholds.push_back(id);
 		}
 		else
 		{
-			local_agents_iter++;
 			fieldSearch(household);
 		}
 	}
-
+	removeDeadHouseholds();
+	return true;
 }
 
 void AnasaziModel::doPerTick()
 {
+	typedef std::chrono::steady_clock clock;
+	clock::time_point t0 = clock::now();
 	updateLocationProperties();
+	clock::time_point t1 = clock::now();
 	writeOutputToFile();
+	clock::time_point t2 = clock::now();
 	year++;
 	updateHouseholdProperties();
+	clock::time_point t3 = clock::now();
 	updateNetwork();//new added
+	clock::time_point t4 = clock::now();
+	phaseSeconds[0] += std::chrono::duration<double>(t1 - t0).count();
+	phaseSeconds[1] += std::chrono::duration<double>(t2 - t1).count();
+	phaseSeconds[2] += std::chrono::duration<double>(t3 - t2).count();
+	phaseSeconds[3] += std::chrono::duration<double>(t4 - t3).count();
 }
 
-void AnasaziModel::initSchedule(repast::ScheduleRunner& runner)
+void AnasaziModel::storeResult()
 {
-	runner.scheduleEvent(1, 1, repast::Schedule::FunctorPtr(new repast::MethodFunctor<AnasaziModel> (this, &AnasaziModel::doPerTick)));
-	runner.scheduleStop(stopAt);
+	std::string storeFile = props->getProperty("results.store");
+	if(storeFile.empty() || world->rank() != 0)
+	{
+		return;
+	}
+	PropertyMap values;
+	for(repast::Properties::key_iterator it = props->keys_begin(); it != props->keys_end(); ++it)
+	{
+		values[*it] = props->getProperty(*it);
+	}
+	StoredRun stored;
+	stored.parameters = recordedParameters(values);
+	stored.seeds.push_back(strtoul(props->getProperty("random.seed").c_str(), NULL, 10));
+	stored.seconds = 0;
+	for(int p = 0; p < TIMING_PHASES; p++)
+	{
+		stored.seconds += phaseSeconds[p];
+	}
+	stored.firstYear = param.startYear;
+	stored.households.push_back(householdTrajectory);
+	stored.capacity.push_back(capacityTrajectory);
+	std::string targetFile = props->getProperty("calibration.target.file");
+	std::vector<double> target = targetFile.empty() ? std::vector<double>() : readTargetTrajectory(targetFile);
+	RunResult result;
+	result.households = stored.households;
+	stored.fitness = target.empty() ? NAN : trajectoryError(result, target);
+	ResultStore store(storeFile);
+	store.append(stored);
 }
 
-void AnasaziModel::readCsvMap()
+void AnasaziModel::writeTiming()
 {
-	int x,y,z , mz;
-	string zone, maizeZone, temp;
-
-	std::ifstream file ("data/map.csv");//define file object and open map.csv
-	file.ignore(500,'\n');//Ignore first line
-
-	while(1)//read until end of file
+	std::string timingFile = props->getProperty("timing.file");
+	if(timingFile.empty())
+	{
+		return;
+	}
+	std::vector<double> local(phaseSeconds, phaseSeconds + TIMING_PHASES);
+	local.push_back(context.size());
+	std::vector<std::vector<double> > ranks;
+	boost::mpi::gather(*world, local, ranks, 0);
+	if(world->rank() != 0)
 	{
-		getline(file,temp,',');
-		if(!temp.empty())
+		return;
+	}
+	int procX = repast::strToInt(props->getProperty("proc.per.x"));
+	int procY = repast::strToInt(props->getProperty("proc.per.y"));
+	std::ofstream timing(timingFile.c_str());
+	timing << "Rank,Ranks,Proc.X,Proc.Y,Ticks,Seconds,TicksPerSecond,Landscape.Seconds,Output.Seconds,Households.Seconds,Network.Seconds,Households.Final" << endl;
+	for(size_t r = 0; r < ranks.size(); r++)
+	{
+		double seconds = 0;
+		for(int p = 0; p < TIMING_PHASES; p++)
 		{
-			x = repast::strToInt(temp); //Read until ',' and convert to int & store in x
-			getline(file,temp,',');
-			y = repast::strToInt(temp); //Read until ',' and convert to int & store in y
-			getline(file,temp,','); //colour
-			getline(file,zone,',');// read until ',' and store into zone
-			getline(file,maizeZone,'\n');// read until next line and store into maizeZone
-			if(zone == "\"Empty\"")
-			{
-				z = 0;
-			}
-			else if(zone == "\"Natural\"")
-			{
-				z = 1;
-			}
-			else if(zone == "\"Kinbiko\"")
-			{
-				z = 2;
-			}
-			else if(zone == "\"Uplands\"")
-			{
-				z = 3;
-			}
-			else if(zone == "\"North\"")
-			{
-				z = 4;
-			}
-			else if(zone == "\"General\"")
-			{
-				z = 5;
-			}
-			else if(zone == "\"North Dunes\"")
-			{
-				z = 6;
-			}
-			else if(zone == "\"Mid Dunes\"")
-			{
-				z = 7;
-			}
-			else if(zone == "\"Mid\"")
-			{
-				z = 8;
-			}
-			else
-			{
-				z = 99;
-			}
-
-			if(maizeZone.find("Empty") != std::string::npos)
-			{
-				mz = 0;
-			}
-			else if(maizeZone.find("No_Yield") != std::string::npos)
-			{
-				mz = 1;
-			}
-			else if(maizeZone.find("Yield_1") != std::string::npos)
-			{
-				mz = 2;
-			}
-			else if(maizeZone.find("Yield_2") != std::string::npos)
-			{
-				mz = 3;
-			}
-			else if(maizeZone.find("Yield_3") != std::string::npos)
-			{
-				mz = 4;
-			}
-			else if(maizeZone.find("Sand_dune") != std::string::npos)
-			{
-				mz = 5;
-			}
-			else
-			{
-				mz = 99;
-			}
-			std::vector<Location*> locationList;
-			locationSpace->getObjectsAt(repast::Point<int>(x, y), locationList);
-			locationList[0]->setZones(z,mz);
+			seconds += ranks[r][p];
 		}
-		else{
-			goto endloop;
+		timing << r << "," << ranks.size() << "," << procX << "," << procY << "," << stopAt << "," << seconds << ","
+			<< (seconds > 0 ? stopAt / seconds : 0);
+		for(int p = 0; p < TIMING_PHASES; p++)
+		{
+			timing << "," << ranks[r][p];
 		}
+		timing << "," << (int)ranks[r][TIMING_PHASES] << endl;
 	}
-	endloop: ;
 }
 
-void AnasaziModel::readCsvWater()
+void AnasaziModel::initSchedule(repast::ScheduleRunner& runner)
 {
-	//read "type","start date","end date","x","y"
-	int type, startYear, endYear, x, y;
-	string temp;
+	runner.scheduleEvent(1, 1, repast::Schedule::FunctorPtr(new repast::MethodFunctor<AnasaziModel> (this, &AnasaziModel::doPerTick)));
+	runner.scheduleStop(stopAt);
+}
 
-	std::ifstream file ("data/water.csv");//define file object and open water.csv
-	file.ignore(500,'\n');//Ignore first line
-	while(1)//read until end of file
+bool AnasaziModel::readCsvMap()
+{
+	//read "x","y","color","zone","maize.zone"
+	int x, y;
+	CsvReader csv("data/map.csv");
+	csv.next();//Ignore first line
+	while(!csv.failed() && csv.next())
 	{
-		getline(file,temp,',');
-		if(!temp.empty())
+		if(!csv.expect(5) || !csv.getInt(0, x) || !csv.getInt(1, y))
 		{
-			getline(file,temp,',');
-			getline(file,temp,',');
-			getline(file,temp,',');
-			type = repast::strToInt(temp); //Read until ',' and convert to int
-			getline(file,temp,',');
-			startYear = repast::strToInt(temp); //Read until ',' and convert to int
-			getline(file,temp,',');
-			endYear = repast::strToInt(temp); //Read until ',' and convert to int
-			getline(file,temp,',');
-			x = repast::strToInt(temp); //Read until ',' and convert to int
-			getline(file,temp,'\n');
-			y = repast::strToInt(temp); //Read until ',' and convert to int
-
-			std::vector<Location*> locationList;
-			locationSpace->getObjectsAt(repast::Point<int>(x, y), locationList);
-			locationList[0]->addWaterSource(type,startYear, endYear);
-			//locationList[0]->checkWater(existStreams, existAlluvium, x, y, year);
+			break;
 		}
-		else
+		if(x < 0 || x >= boardSizeX || y < 0 || y >= boardSizeY)
 		{
-			goto endloop;
+			csv.fail("cell outside the board");
+			break;
 		}
+		std::vector<Location*> locationList;
+		locationSpace->getObjectsAt(repast::Point<int>(x, y), locationList);
+		locationList[0]->setZones(Landscape::zoneFromName(csv.field(3)), Landscape::maizeZoneFromName(csv.field(4)));
+	}
+	if(csv.failed())
+	{
+		std::cerr << "map: " << csv.getError() << std::endl;
+		return false;
 	}
-	endloop: ;
+	return true;
 }
 
-void AnasaziModel::readCsvPdsi()
+bool AnasaziModel::readCsvWater()
 {
-	//read "year","general","north","mid","natural","upland","kinbiko"
-	int i=0;
-	string temp;
-
-	std::ifstream file ("data/pdsi.csv");//define file object and open pdsi.csv
-	file.ignore(500,'\n');//Ignore first line
-
-	while(1)//read until end of file
+	//read "id number","meters north","meters east","type","start date","end date","x","y"
+	int type, startYear, endYear, x, y;
+	CsvReader csv("data/water.csv");
+	csv.next();//Ignore first line
+	while(!csv.failed() && csv.next())
 	{
-		getline(file,temp,',');
-		if(!temp.empty())
+		if(!csv.expect(8) || !csv.getInt(3, type) || !csv.getInt(4, startYear) || !csv.getInt(5, endYear)
+			|| !csv.getInt(6, x) || !csv.getInt(7, y))
 		{
-			pdsi[i].year = repast::strToInt(temp); //Read until ',' and convert to int
-			getline(file,temp,',');
-			pdsi[i].pdsiGeneral = repast::strToDouble(temp); //Read until ',' and convert to double
-			getline(file,temp,',');
-			pdsi[i].pdsiNorth = repast::strToDouble(temp); //Read until ',' and convert to double
-			getline(file,temp,',');
-			pdsi[i].pdsiMid = repast::strToDouble(temp); //Read until ',' and convert to double
-			getline(file,temp,',');
-			pdsi[i].pdsiNatural = repast::strToDouble(temp); //Read until ',' and convert to int
-			getline(file,temp,',');
-			pdsi[i].pdsiUpland = repast::strToDouble(temp); //Read until ',' and convert to int
-			getline(file,temp,'\n');
-			pdsi[i].pdsiKinbiko = repast::strToDouble(temp); //Read until ',' and convert to double
-			i++;
+			break;
 		}
-		else{
-			goto endloop;
+		if(x < 0 || x >= boardSizeX || y < 0 || y >= boardSizeY)
+		{
+			csv.fail("cell outside the board");
+			break;
 		}
+		std::vector<Location*> locationList;
+		locationSpace->getObjectsAt(repast::Point<int>(x, y), locationList);
+		locationList[0]->addWaterSource(type,startYear, endYear);
 	}
-	endloop: ;
+	if(csv.failed())
+	{
+		std::cerr << "water: " << csv.getError() << std::endl;
+		return false;
+	}
+	return true;
 }
 
-void AnasaziModel::readCsvHydro()
+int AnasaziModel::climateWindow()
 {
-	//read "year","general","north","mid","natural","upland","kinbiko"
-	string temp;
-	int i =0;
+	string window = props->getProperty("climate.window");
+	return window.empty() ? 64 : repast::strToInt(window);
+}
 
-	std::ifstream file ("data/hydro.csv");//define file object and open hydro.csv
-	file.ignore(500,'\n');//Ignore first line
+bool AnasaziModel::readCsvPdsi()
+{
+	//index "year","general","north","mid","natural","upland","kinbiko"; rows outside the file read as 0
+	if(!pdsiSeries.index("data/pdsi.csv", climateWindow()))
+	{
+		return false;
+	}
+	pdsi = new ClimateReader(&pdsiSeries);
+	return true;
+}
 
-	while(1)//read until end of file
+bool AnasaziModel::readCsvHydro()
+{
+	if(!hydroSeries.index("data/hydro.csv", climateWindow()))
 	{
-		getline(file,temp,',');
-		if(!temp.empty())
-		{
-			hydro[i].year = repast::strToInt(temp); //Read until ',' and convert to int
-			getline(file,temp,',');
-			hydro[i].hydroGeneral = repast::strToDouble(temp); //Read until ',' and convert to double
-			getline(file,temp,',');
-			hydro[i].hydroNorth = repast::strToDouble(temp); //Read until ',' and convert to double
-			getline(file,temp,',');
-			hydro[i].hydroMid = repast::strToDouble(temp); //Read until ',' and convert to double
-			getline(file,temp,',');
-			hydro[i].hydroNatural = repast::strToDouble(temp); //Read until ',' and convert to int
-			getline(file,temp,',');
-			hydro[i].hydroUpland = repast::strToDouble(temp); //Read until ',' and convert to int
-			getline(file,temp,'\n');
-			hydro[i].hydroKinbiko = repast::strToDouble(temp); //Read until ',' and convert to double
-			i++;
-		}
-		else
-		{
-			goto endloop;
-		}
+		return false;
 	}
-	endloop: ;
+	hydro = new ClimateReader(&hydroSeries);
+	return true;
 }
 
 int AnasaziModel::yieldFromPdsi(int zone, int maizeZone)
 {
 	int pdsiValue, row, col;
+	const ClimateRow& p = pdsi->at(year);
 	switch(zone)
 	{
 		case 1:
-			pdsiValue = pdsi[year-param.startYear].pdsiNatural;
+			pdsiValue = p.natural;
 			break;
 		case 2:
-			pdsiValue = pdsi[year-param.startYear].pdsiKinbiko;
+			pdsiValue = p.kinbiko;
 			break;
 		case 3:
-			pdsiValue = pdsi[year-param.startYear].pdsiUpland;
+			pdsiValue = p.upland;
 			break;
 		case 4:
 		case 6:
-			pdsiValue = pdsi[year-param.startYear].pdsiNorth;
+			pdsiValue = p.north;
 			break;
 		case 5:
-			pdsiValue = pdsi[year-param.startYear].pdsiGeneral;
+			pdsiValue = p.general;
 			break;
 		case 7:
 		case 8:
-			pdsiValue = pdsi[year-param.startYear].pdsiMid;
+			pdsiValue = p.mid;
 			break;
 		default:
 			return 0;
@@ -498,22 +473,23 @@ int AnasaziModel::yieldFromPdsi(int zone, int maizeZone)
 
 double AnasaziModel::hydroLevel(int zone)
 {
+	const ClimateRow& h = hydro->at(year);
 	switch(zone)
 	{
 		case 1:
-			return hydro[year-param.startYear].hydroNatural;
+			return h.natural;
 		case 2:
-			return hydro[year-param.startYear].hydroKinbiko;
+			return h.kinbiko;
 		case 3:
-			return hydro[year-param.startYear].hydroUpland;
+			return h.upland;
 		case 4:
 		case 6:
-			return hydro[year-param.startYear].hydroNorth;
+			return h.north;
 		case 5:
-			return hydro[year-param.startYear].hydroGeneral;
+			return h.general;
 		case 7:
 		case 8:
-			return hydro[year-param.startYear].hydroMid;
+			return h.mid;
 		default:
 			return 0;
 	}
@@ -543,6 +519,8 @@ void AnasaziModel::checkWaterConditions()
 void AnasaziModel::writeOutputToFile()
 {
 	out << year << "," <<  context.size() << "," << maxCapacity << std::endl;
+	householdTrajectory.push_back(context.size());
+	capacityTrajectory.push_back(maxCapacity);
 }
 
 void  AnasaziModel::updateLocationProperties()
@@ -572,28 +550,52 @@ void  AnasaziModel::updateLocationProperties()
 
 void AnasaziModel::updateHouseholdProperties()
 {
+	//only households reaching a death or fission-window age this year are looked at
+	int rank = repast::RepastProcess::instance()->rank();
+	std::vector<int> due;
+	schedule->due(year, due);
+	for(size_t i = 0; i < due.size(); i++)
+	{
+		Household* household = context.getAgent(repast::AgentId(due[i], rank, 2));
+		if(household != NULL)
+		{
+			schedule->update(due[i], household->getAge(), household->getDeathAge());
+		}
+	}
+	//every household splits at most once a tick, so the contact matrix is grown
+	//once for all of this tick's children instead of at every birth. Fissions stay
+	//in turn: a child's field search sees the fields earlier parents claimed, which
+	//is the model's rule, so assigning fields after the loop would change its runs
+	growContacts(houseID + context.size());
+	//children from here on were scheduled as if first visited next year
+	int firstChild = houseID;
+
+	//removals only leave tombstones, so the iterator is never invalidated here
 	repast::SharedContext<Household>::const_iterator local_agents_iter = context.begin();
 	repast::SharedContext<Household>::const_iterator local_agents_end = context.end();
 
-	while(local_agents_iter != local_agents_end)
+	for(; local_agents_iter != local_agents_end; local_agents_iter++)
 	{
 		Household* household = (&**local_agents_iter);
-		if(household->death())
+		if(!household->isAlive())
+		{
+			continue;
+		}
+		if(schedule->isDying(household->getId().id()))
 		{
-			local_agents_iter++;
 			removeHousehold(household);
-
 		}
 		else
 		{
-			local_agents_iter++;
-			if(household->fission(param.minFissionAge,param.maxFissionAge, fissionGen->next(), param.fertilityProbability))
+			//the fission draw is only taken inside the fission window
+			if(schedule->isFertile(household->getId().id()) && household->fission(param.minFissionAge,param.maxFissionAge, fissionGen->next(), param.fertilityProbability))
 			{
-				int rank = repast::RepastProcess::instance()->rank();
 				repast::AgentId id(houseID, rank, 2);
 				int mStorage = household->splitMaizeStored(param.maizeStorageRatio);
-				Household* newAgent = new Household(id, 0, deathAgeGen->next(), mStorage);
+				int deathAge = deathAgeGen->next();
+				Household* newAgent = new Household(id, 0, deathAge, mStorage);
 				context.addAgent(newAgent);
+				schedule->add(houseID, year + 1, 0, deathAge);
 
 				std::vector<int> loc;
 				householdSpace->getLocation(household->getId(), loc);
@@ -626,6 +628,12 @@ void AnasaziModel::updateHouseholdProperties()
 					MovewithFriends(locgoal, household);
 				}
 				household->nextYear(param.householdNeed);
+				//context order can bring a child up in the tick it was born in, so it
+				//is a year older than its wheel entries assume
+				if(household->getId().id() >= firstChild)
+				{
+					schedule->extraYear(household->getId().id(), year, household->getAge(), household->getDeathAge());
+				}
 			}
 			//if(moveoutflag)
 			//{
@@ -634,6 +642,7 @@ void AnasaziModel::updateHouseholdProperties()
 			//}
 		}
 	}
+	removeDeadHouseholds();
 	updateCloseness();
 }
 
@@ -699,7 +708,7 @@ void AnasaziModel::removeHousehold(Household* household)
 	if(!loc.empty())
 	{
 		locationSpace->getObjectsAt(repast::Point<int>(loc[0], loc[1]), locationList);
-		householdSpace->getObjectsAt(repast::Point<int>(loc[0], loc[1]), householdList);
+		liveHouseholdsAt(loc[0], loc[1], householdList);
 		if(householdList.size() == 1)
 		{
 			locationList[0]->setState(0);
@@ -713,7 +722,46 @@ void AnasaziModel::removeHousehold(Household* household)
 		}
 	}
 
-	context.removeAgent(id);
+	//cell states are freed at once, the agent itself in removeDeadHouseholds
+	household->markRemoved();
+	schedule->remove(id.id());
+	removedHouseholds.push_back(id);
+}
+
+//applies the tick's tombstones in one pass, dropping the closeness other households kept of them
+void AnasaziModel::removeDeadHouseholds()
+{
+	if(removedHouseholds.empty())
+	{
+		return;
+	}
+	for(size_t i = 0; i < removedHouseholds.size(); i++)
+	{
+		context.removeAgent(removedHouseholds[i]);
+	}
+	repast::SharedContext<Household>::const_iterator it = context.begin();
+	for(; it != context.end(); it++)
+	{
+		Household* household = (&**it);
+		for(size_t i = 0; i < removedHouseholds.size(); i++)
+		{
+			household->eraseCloseness(removedHouseholds[i]);
+		}
+	}
+	removedHouseholds.clear();
+}
+
+void AnasaziModel::liveHouseholdsAt(int x, int y, std::vector<Household*>& householdList)
+{
+	std::vector<Household*> all;
+	householdSpace->getObjectsAt(repast::Point<int>(x, y), all);
+	for(size_t i = 0; i < all.size(); i++)
+	{
+		if(all[i]->isAlive())
+		{
+			householdList.push_back(all[i]);
+		}
+	}
 }
 
 bool AnasaziModel::relocateHousehold(Household* household)
@@ -877,7 +925,7 @@ bool AnasaziModel::ShareFood(Household* household)
 	BDIgiver.w0 = 1;
 	BDIreciever.w0 = 1;
 	householdSpace->getLocation(household->getId(),loc);
-	householdSpace->getObjectsAt(repast::Point<int>(loc[0], loc[1]), householdList);
+	liveHouseholdsAt(loc[0], loc[1], householdList);
 	
 	std::sort(householdList.begin(), householdList.end(), 
         [household](const Household* a, const Household* b) {
@@ -976,7 +1024,7 @@ bool AnasaziModel::MovewithFriends(std::vector<int> locgoal, Household* househol
 	int range = 1;
 	if(!locgoal.empty())
 	{
-		householdSpace->getObjectsAt(repast::Point<int>(locgoal[0], locgoal[1]), householdList);
+		liveHouseholdsAt(locgoal[0], locgoal[1], householdList);
 	}
 	for (std::vector<Household*>::iterator it = householdList.begin() ; it != householdList.end(); ++it)
 	{
@@ -1013,10 +1061,10 @@ bool AnasaziModel::MovewithFriends(std::vector<int> locgoal, Household* househol
 			}
 			else
 			{
-				std::cout << "movewithfriend" << std::endl;	
 				tempHousehold->chooseField(tempLocSet);
 				householdSpace->moveTo(tempHousehold->getId(), repast::Point<int>(locgoal[0], locgoal[1]));
 				tempHousehold->nextYear(param.householdNeed);
+				schedule->extraYear(tempHousehold->getId().id(), year, tempHousehold->getAge(), tempHousehold->getDeathAge());
 				return true;
 			}
 		}	
@@ -1034,7 +1082,7 @@ bool AnasaziModel::Moveout(std::vector<int> locgoal, Household* household)
 	int range = 1;
 	if(!locgoal.empty())
 	{
-		householdSpace->getObjectsAt(repast::Point<int>(locgoal[0], locgoal[1]), householdList);
+		liveHouseholdsAt(locgoal[0], locgoal[1], householdList);
 	}
     if(householdList.empty())
 	{
@@ -1049,7 +1097,6 @@ bool AnasaziModel::Moveout(std::vector<int> locgoal, Household* household)
 		{	
 			if(tempHousehold->getMaize() < 1.2*param.householdNeed)
 			{
-				std::cout << "moveout" << std::endl;	
 				removeHousehold(tempHousehold);
 			}
 		}	
@@ -1058,13 +1105,22 @@ bool AnasaziModel::Moveout(std::vector<int> locgoal, Household* household)
 }
 
 
+void AnasaziModel::growContacts(int agents) {
+	int size = adjacencyMatrix.size();
+	if(agents <= size){
+		return;
+	}
+	//rows are copied on every growth, so a quarter more is kept in hand
+	int newSize = std::max(agents, size + size/4);
+	for (auto& row : adjacencyMatrix) {
+		row.resize(newSize, 0);
+	}
+	adjacencyMatrix.resize(newSize, std::vector<int>(newSize, 0));
+}
+
 void AnasaziModel::addNewAgentContacts(int agentId) {
     int id = agentId;
-    int newSize = id;
-    adjacencyMatrix.resize(newSize, std::vector<int>(newSize, 0));
-    for (auto& row : adjacencyMatrix) {
-        row.resize(newSize, 0);
-    }
+	growContacts(id + 1);
 	int i;
 	for(i=0;i<id;i++){
 		if(rand()<Probability){
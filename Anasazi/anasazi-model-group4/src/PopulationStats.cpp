@@ -0,0 +1,204 @@
+#include <math.h>
+#include <algorithm>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "PopulationStats.h"
+
+static const double storageQuantiles[] = {0.1, 0.25, 0.5, 0.75, 0.9};
+static const int storageQuantileCount = 5;
+static const char* zoneNames[] = {"Empty", "Natural", "Kinbiko", "Uplands", "North", "General", "North.Dunes", "Mid.Dunes", "Mid", "Unknown"};
+static const int zoneSlots = 10;
+
+QuantileSketch::QuantileSketch(double alpha)
+{
+	gamma = (1 + alpha) / (1 - alpha);
+	logGamma = log(gamma);
+	zeros = 0;
+	count = 0;
+}
+
+//magnitudes below 1 share bucket 0; maize storage is whole kilograms
+int QuantileSketch::bucket(double magnitude) const
+{
+	return magnitude <= 1 ? 0 : (int)ceil(log(magnitude) / logGamma);
+}
+
+double QuantileSketch::bucketValue(int index) const
+{
+	return index == 0 ? 1 : 2*pow(gamma, index) / (gamma + 1);
+}
+
+void QuantileSketch::change(double value, int delta)
+{
+	count += delta;
+	if(value == 0)
+	{
+		zeros += delta;
+		return;
+	}
+	std::vector<int>& store = value > 0 ? positive : negative;
+	int index = bucket(fabs(value));
+	if(index >= (int)store.size())
+	{
+		store.resize(index + 1, 0);
+	}
+	store[index] += delta;
+}
+
+double QuantileSketch::quantile(double q) const
+{
+	if(count <= 0)
+	{
+		return 0;
+	}
+	int rank = (int)(q*(count - 1));
+	int seen = 0;
+	for(int i = negative.size() - 1; i >= 0; i--)
+	{
+		seen += negative[i];
+		if(seen > rank)
+		{
+			return -bucketValue(i);
+		}
+	}
+	seen += zeros;
+	if(seen > rank)
+	{
+		return 0;
+	}
+	for(size_t i = 0; i < positive.size(); i++)
+	{
+		seen += positive[i];
+		if(seen > rank)
+		{
+			return bucketValue(i);
+		}
+	}
+	return positive.empty() ? 0 : bucketValue(positive.size() - 1);
+}
+
+PopulationStats::PopulationStats(int maxAge, int ageBinWidth)
+	: storage(0.01)
+{
+	ageBin = std::max(1, ageBinWidth);
+	ageCount.assign(maxAge + 2, 0);
+	zoneCount.assign(zoneSlots, 0);
+	households = 0;
+	fedByShare = 0;
+	relocations = 0;
+}
+
+int PopulationStats::zoneSlot(int zone)
+{
+	return zone >= 0 && zone < zoneSlots - 1 ? zone : zoneSlots - 1;
+}
+
+int PopulationStats::ageSlot(int age) const
+{
+	return std::min(std::max(age, 0), (int)ageCount.size() - 1);
+}
+
+void PopulationStats::addHousehold(int age, int maizeStorage)
+{
+	households++;
+	ageCount[ageSlot(age)]++;
+	storage.add(maizeStorage);
+}
+
+void PopulationStats::removeHousehold(int age, int maizeStorage)
+{
+	households--;
+	ageCount[ageSlot(age)]--;
+	storage.remove(maizeStorage);
+}
+
+void PopulationStats::changeStorage(int from, int to)
+{
+	if(from != to)
+	{
+		storage.remove(from);
+		storage.add(to);
+	}
+}
+
+//called before the age is incremented
+void PopulationStats::ageHousehold(int age)
+{
+	ageCount[ageSlot(age)]--;
+	ageCount[ageSlot(age + 1)]++;
+}
+
+void PopulationStats::record(int year)
+{
+	YearRow row;
+	row.year = year;
+	row.households = households;
+	for(size_t a = 0; a < ageCount.size(); a++)
+	{
+		if(a % ageBin == 0)
+		{
+			row.ages.push_back(0);
+		}
+		row.ages.back() += ageCount[a];
+	}
+	for(int q = 0; q < storageQuantileCount; q++)
+	{
+		row.storage.push_back(storage.quantile(storageQuantiles[q]));
+	}
+	row.fedByShare = fedByShare;
+	row.relocations = relocations;
+	row.zones = zoneCount;
+	rows.push_back(row);
+	fedByShare = 0;
+	relocations = 0;
+}
+
+void PopulationStats::writeHeader(std::ostream& out, int maxAge, int ageBinWidth, bool withSeed)
+{
+	int bin = std::max(1, ageBinWidth);
+	if(withSeed)
+	{
+		out << "Seed,";
+	}
+	out << "Year,Households";
+	for(int a = 0; a <= maxAge + 1; a += bin)
+	{
+		out << ",Age." << a;
+	}
+	for(int q = 0; q < storageQuantileCount; q++)
+	{
+		out << ",Storage.p" << (int)(storageQuantiles[q]*100);
+	}
+	out << ",Fed.By.Sharing,Relocations";
+	for(int z = 0; z < zoneSlots; z++)
+	{
+		out << ",Zone." << zoneNames[z];
+	}
+	out << std::endl;
+}
+
+//Age.a counts households aged a to a+bin-1; the last age bin also holds everyone older
+void PopulationStats::write(std::ostream& out, const std::string& prefix) const
+{
+	for(size_t r = 0; r < rows.size(); r++)
+	{
+		const YearRow& row = rows[r];
+		out << prefix << row.year << "," << row.households;
+		for(size_t a = 0; a < row.ages.size(); a++)
+		{
+			out << "," << row.ages[a];
+		}
+		for(size_t q = 0; q < row.storage.size(); q++)
+		{
+			out << "," << row.storage[q];
+		}
+		out << "," << row.fedByShare << "," << row.relocations;
+		for(size_t z = 0; z < row.zones.size(); z++)
+		{
+			out << "," << row.zones[z];
+		}
+		out << "\n";
+	}
+}
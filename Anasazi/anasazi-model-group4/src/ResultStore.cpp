@@ -0,0 +1,442 @@
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <zlib.h>
+
+#include "ByteCodec.h"
+#include "ResultStore.h"
+
+static const char resultMagic[8] = {'A', 'N', 'A', 'R', 'E', 'S', '0', '1'};
+static const int HEADER_BYTES = 16;		//raw size, packed size, parameter hash
+
+static void putString(std::string& bytes, const std::string& text)
+{
+	putVarint(bytes, text.size());
+	bytes += text;
+}
+
+static void putDouble(std::string& bytes, double value)
+{
+	char b[sizeof(double)];
+	memcpy(b, &value, sizeof(double));
+	bytes.append(b, sizeof(double));
+}
+
+static std::string getString(const std::string& bytes, size_t& pos)
+{
+	size_t length = std::min<size_t>(getVarint(bytes, pos), bytes.size() - pos);
+	std::string text = bytes.substr(pos, length);
+	pos += length;
+	return text;
+}
+
+static double getDouble(const std::string& bytes, size_t& pos)
+{
+	double value = NAN;
+	if(pos + sizeof(double) <= bytes.size())
+	{
+		memcpy(&value, &bytes[pos], sizeof(double));
+	}
+	pos += sizeof(double);
+	return value;
+}
+
+static void putColumn(std::string& bytes, const std::vector<std::vector<int> >& trajectories)
+{
+	for(size_t l = 0; l < trajectories.size(); l++)
+	{
+		const std::vector<int>& t = trajectories[l];
+		putVarint(bytes, t.size());
+		int last = 0;
+		for(size_t y = 0; y < t.size(); y++)
+		{
+			putSigned(bytes, t[y] - last);
+			last = t[y];
+		}
+	}
+}
+
+static void getColumn(const std::string& bytes, size_t& pos, std::vector<std::vector<int> >& trajectories, size_t lanes)
+{
+	trajectories.assign(lanes, std::vector<int>());
+	for(size_t l = 0; l < lanes; l++)
+	{
+		std::vector<int>& t = trajectories[l];
+		t.resize(std::min<size_t>(getVarint(bytes, pos), bytes.size() - pos));
+		int last = 0;
+		for(size_t y = 0; y < t.size(); y++)
+		{
+			last += getSigned(bytes, pos);
+			t[y] = last;
+		}
+	}
+}
+
+//numbers are filed by value, so "0.10000" in model.props and "0.1" from a
+//calibration point are the same parameter
+static std::string canonicalValue(const std::string& value)
+{
+	const char* text = value.c_str();
+	char* end;
+	double number = strtod(text, &end);
+	if(value.empty() || *end != 0)
+	{
+		return value;
+	}
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%.10g", number);
+	return buffer;
+}
+
+uint64_t parameterHash(const PropertyMap& parameters)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for(PropertyMap::const_iterator it = parameters.begin(); it != parameters.end(); ++it)
+	{
+		std::string line = it->first + "=" + it->second + "\n";
+		for(size_t i = 0; i < line.size(); i++)
+		{
+			hash = (hash ^ (unsigned char)line[i]) * 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+PropertyMap recordedParameters(const PropertyMap& props)
+{
+	std::vector<std::string> keys;
+	PropertyMap::const_iterator list = props.find("results.parameters");
+	if(list != props.end() && !list->second.empty())
+	{
+		std::stringstream text(list->second);
+		std::string key;
+		while(getline(text, key, ','))
+		{
+			key.erase(0, key.find_first_not_of(" \t"));
+			key.erase(key.find_last_not_of(" \t") + 1);
+			keys.push_back(key);
+		}
+	}
+	else
+	{
+		const char* prefixes[] = {"calibration.range.", "sensitivity.range."};
+		for(int p = 0; p < 2; p++)
+		{
+			std::vector<ParameterRange> ranges = readParameterRanges(props, prefixes[p]);
+			for(size_t i = 0; i < ranges.size(); i++)
+			{
+				keys.push_back(ranges[i].key);
+			}
+		}
+	}
+	PropertyMap parameters;
+	for(size_t i = 0; i < keys.size(); i++)
+	{
+		PropertyMap::const_iterator it = props.find(keys[i]);
+		if(it != props.end())
+		{
+			parameters[keys[i]] = canonicalValue(it->second);
+		}
+	}
+	return parameters;
+}
+
+ResultStore::ResultStore(const std::string& fileName)
+{
+	file = fileName;
+	fd = open(file.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+	if(fd < 0)
+	{
+		std::cerr << "results: cannot open " << file << std::endl;
+		return;
+	}
+	//the first writer of a new file puts the header
+	flock(fd, LOCK_EX);
+	struct stat info;
+	if(fstat(fd, &info) == 0 && info.st_size == 0 && write(fd, resultMagic, sizeof(resultMagic)) != sizeof(resultMagic))
+	{
+		std::cerr << "results: cannot write " << file << std::endl;
+	}
+	flock(fd, LOCK_UN);
+}
+
+ResultStore::~ResultStore()
+{
+	if(fd >= 0)
+	{
+		close(fd);
+	}
+}
+
+bool ResultStore::append(const StoredRun& run)
+{
+	if(fd < 0)
+	{
+		return false;
+	}
+	std::string body;
+	putVarint(body, run.parameters.size());
+	for(PropertyMap::const_iterator it = run.parameters.begin(); it != run.parameters.end(); ++it)
+	{
+		putString(body, it->first);
+		putString(body, it->second);
+	}
+	putVarint(body, run.seeds.size());
+	for(size_t l = 0; l < run.seeds.size(); l++)
+	{
+		putVarint(body, run.seeds[l]);
+	}
+	putDouble(body, run.fitness);
+	putDouble(body, run.seconds);
+	putSigned(body, run.firstYear);
+	putVarint(body, run.households.size());
+	putColumn(body, run.households);
+	putVarint(body, run.capacity.size());
+	putColumn(body, run.capacity);
+
+	uLongf packedSize = compressBound(body.size());
+	std::vector<unsigned char> record(HEADER_BYTES + packedSize);
+	compress2(&record[HEADER_BYTES], &packedSize, (const Bytef*)body.data(), body.size(), Z_DEFAULT_COMPRESSION);
+	record.resize(HEADER_BYTES + packedSize);
+	uint64_t hash = parameterHash(run.parameters);
+	putWord(&record[0], body.size());
+	putWord(&record[4], packedSize);
+	putWord(&record[8], (uint32_t)hash);
+	putWord(&record[12], (uint32_t)(hash >> 32));
+
+	std::lock_guard<std::mutex> lock(mutex);
+	flock(fd, LOCK_EX);
+	size_t done = 0;
+	while(done < record.size())
+	{
+		ssize_t n = write(fd, &record[done], record.size() - done);
+		if(n <= 0)
+		{
+			break;
+		}
+		done += n;
+	}
+	flock(fd, LOCK_UN);
+	if(done < record.size())
+	{
+		std::cerr << "results: write to " << file << " failed" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+ResultReader::ResultReader(const std::string& fileName)
+	: in(fileName.c_str(), std::ios::binary)
+{
+	char magic[sizeof(resultMagic)];
+	if(!in.read(magic, sizeof(magic)) || memcmp(magic, resultMagic, sizeof(magic)) != 0)
+	{
+		std::cerr << "results: " << fileName << " is not a results file" << std::endl;
+		in.close();
+		return;
+	}
+	in.seekg(0, std::ios::end);
+	uint64_t end = in.tellg();
+	uint64_t pos = sizeof(resultMagic);
+	unsigned char header[HEADER_BYTES];
+	while(pos + HEADER_BYTES <= end)
+	{
+		in.seekg(pos);
+		if(!in.read((char*)header, HEADER_BYTES))
+		{
+			break;
+		}
+		uint64_t next = pos + HEADER_BYTES + getWord(header + 4);
+		if(next > end)
+		{
+			break;
+		}
+		uint64_t hash = getWord(header + 8) | (uint64_t)getWord(header + 12) << 32;
+		index.insert(std::make_pair(hash, (int)offsets.size()));
+		offsets.push_back(pos);
+		hashes.push_back(hash);
+		pos = next;
+	}
+	if(pos != end)
+	{
+		std::cerr << "results: " << fileName << " ends inside a row group, " << offsets.size() << " runs read" << std::endl;
+	}
+	in.clear();
+}
+
+std::vector<int> ResultReader::find(const PropertyMap& parameters) const
+{
+	std::vector<int> found;
+	typedef std::unordered_multimap<uint64_t, int>::const_iterator Iterator;
+	std::pair<Iterator, Iterator> range = index.equal_range(parameterHash(parameters));
+	for(Iterator it = range.first; it != range.second; ++it)
+	{
+		StoredRun run;
+		if(read(it->second, run) && run.parameters == parameters)
+		{
+			found.push_back(it->second);
+		}
+	}
+	std::sort(found.begin(), found.end());
+	return found;
+}
+
+std::vector<int> ResultReader::match(const PropertyMap& parameters) const
+{
+	std::vector<int> found;
+	StoredRun run;
+	for(int i = 0; i < size(); i++)
+	{
+		if(!read(i, run))
+		{
+			continue;
+		}
+		bool matches = true;
+		for(PropertyMap::const_iterator it = parameters.begin(); matches && it != parameters.end(); ++it)
+		{
+			PropertyMap::const_iterator stored = run.parameters.find(it->first);
+			matches = stored != run.parameters.end() && stored->second == it->second;
+		}
+		if(matches)
+		{
+			found.push_back(i);
+		}
+	}
+	return found;
+}
+
+bool ResultReader::read(int i, StoredRun& run) const
+{
+	unsigned char header[HEADER_BYTES];
+	in.seekg(offsets[i]);
+	if(!in.read((char*)header, HEADER_BYTES))
+	{
+		in.clear();
+		return false;
+	}
+	uLongf rawSize = getWord(header);
+	std::vector<unsigned char> packed(getWord(header + 4));
+	std::string body(rawSize, '\0');
+	if(!in.read((char*)&packed[0], packed.size())
+		|| uncompress((Bytef*)&body[0], &rawSize, &packed[0], packed.size()) != Z_OK || rawSize != body.size())
+	{
+		in.clear();
+		std::cerr << "results: row group " << i << " is corrupt" << std::endl;
+		return false;
+	}
+
+	size_t pos = 0;
+	run.parameters.clear();
+	uint32_t count = getVarint(body, pos);
+	for(uint32_t k = 0; k < count && pos < body.size(); k++)
+	{
+		std::string key = getString(body, pos);
+		run.parameters[key] = getString(body, pos);
+	}
+	run.seeds.resize(std::min<size_t>(getVarint(body, pos), body.size() - pos));
+	for(size_t l = 0; l < run.seeds.size(); l++)
+	{
+		run.seeds[l] = getVarint(body, pos);
+	}
+	run.fitness = getDouble(body, pos);
+	run.seconds = getDouble(body, pos);
+	run.firstYear = getSigned(body, pos);
+	getColumn(body, pos, run.households, std::min<size_t>(getVarint(body, pos), body.size() - pos));
+	getColumn(body, pos, run.capacity, std::min<size_t>(getVarint(body, pos), body.size() - pos));
+	return pos <= body.size();
+}
+
+bool writeResultTables(const std::string& storeFile, const std::string& query, std::ostream& runs, std::ostream* trajectories)
+{
+	ResultReader reader(storeFile);
+	std::vector<int> selected;
+	if(query.empty())
+	{
+		for(int i = 0; i < reader.size(); i++)
+		{
+			selected.push_back(i);
+		}
+	}
+	else
+	{
+		PropertyMap parameters;
+		std::stringstream text(query);
+		std::string item;
+		while(getline(text, item, ','))
+		{
+			size_t equals = item.find('=');
+			if(equals == std::string::npos)
+			{
+				std::cerr << "results: query item \"" << item << "\" is not key=value" << std::endl;
+				return false;
+			}
+			parameters[item.substr(0, equals)] = canonicalValue(item.substr(equals + 1));
+		}
+		selected = reader.find(parameters);
+		if(selected.empty())
+		{
+			selected = reader.match(parameters);
+		}
+	}
+
+	runs << "Run,Hash,Parameters,Seeds,Fitness,Seconds,Mean.Households,Final.Households" << std::endl;
+	if(trajectories)
+	{
+		*trajectories << "Run,Seed,Year,Households,MaxCapacity" << std::endl;
+	}
+	StoredRun run;
+	for(size_t k = 0; k < selected.size(); k++)
+	{
+		int i = selected[k];
+		if(!reader.read(i, run))
+		{
+			return false;
+		}
+		std::string parameters, seeds;
+		for(PropertyMap::const_iterator it = run.parameters.begin(); it != run.parameters.end(); ++it)
+		{
+			parameters += (parameters.empty() ? "" : " ") + it->first + "=" + it->second;
+		}
+		double mean = 0, last = 0;
+		for(size_t l = 0; l < run.households.size(); l++)
+		{
+			const std::vector<int>& h = run.households[l];
+			double sum = 0;
+			for(size_t y = 0; y < h.size(); y++) sum += h[y];
+			mean += h.empty() ? 0 : sum / h.size();
+			last += h.empty() ? 0 : h.back();
+			seeds += (l > 0 ? " " : "") + std::to_string(l < run.seeds.size() ? run.seeds[l] : 0);
+		}
+		int lanes = std::max<int>(1, run.households.size());
+		std::ostringstream hash;
+		hash << std::hex << reader.getHash(i);
+		runs << i << "," << hash.str() << ",\"" << parameters << "\",\"" << seeds << "\",";
+		if(!isnan(run.fitness))
+		{
+			runs << run.fitness;
+		}
+		runs << "," << run.seconds << "," << mean / lanes << "," << last / lanes << "\n";
+		if(!trajectories)
+		{
+			continue;
+		}
+		for(size_t l = 0; l < run.households.size(); l++)
+		{
+			const std::vector<int>& h = run.households[l];
+			for(size_t y = 0; y < h.size(); y++)
+			{
+				*trajectories << i << "," << (l < run.seeds.size() ? run.seeds[l] : 0) << "," << run.firstYear + (int)y << "," << h[y] << ","
+					<< (l < run.capacity.size() && y < run.capacity[l].size() ? run.capacity[l][y] : 0) << "\n";
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,189 @@
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/random/uniform_int.hpp>
+#include <boost/random/uniform_real.hpp>
+
+#include "Sensitivity.h"
+
+Sensitivity::Sensitivity(const BatchRunner* r, const PropertyMap& props)
+{
+	runner = r;
+	dims = readParameterRanges(props, "sensitivity.range.");
+	samples = std::max(2, propOr(props, "sensitivity.samples", 256));
+	chunkRows = 32;
+	rng.seed(propOr(props, "random.seed", 1));
+}
+
+Sensitivity::~Sensitivity() {}
+
+bool Sensitivity::readTarget(const std::string& file)
+{
+	if(!file.empty())
+	{
+		target = readTargetTrajectory(file);
+		return !target.empty();
+	}
+	return true;
+}
+
+std::vector<std::string> Sensitivity::metricNames() const
+{
+	std::vector<std::string> names;
+	if(!target.empty())
+	{
+		names.push_back("fitness");
+	}
+	names.push_back("mean.households");
+	names.push_back("final.households");
+	return names;
+}
+
+//scalar outputs of one run, in metricNames() order
+std::vector<double> Sensitivity::metrics(const RunResult& result) const
+{
+	std::vector<double> values;
+	if(!target.empty())
+	{
+		values.push_back(trajectoryError(result, target));
+	}
+	double mean = 0, last = 0;
+	for(size_t l = 0; l < result.households.size(); l++)
+	{
+		const std::vector<int>& h = result.households[l];
+		double sum = 0;
+		for(size_t t = 0; t < h.size(); t++) sum += h[t];
+		mean += h.empty() ? 0 : sum / h.size();
+		last += h.empty() ? 0 : h.back();
+	}
+	int lanes = std::max<int>(1, result.households.size());
+	values.push_back(mean / lanes);
+	values.push_back(last / lanes);
+	return values;
+}
+
+//fAB holds row-major [row*d + i]; rows selects (with repetition) the sample rows used
+void Sensitivity::estimate(const std::vector<double>& fA, const std::vector<double>& fB, const std::vector<double>& fAB,
+		const std::vector<int>& rows, std::vector<double>& first, std::vector<double>& total) const
+{
+	int d = dims.size();
+	int n = rows.size();
+	double mean = 0, variance = 0;
+	for(int k = 0; k < n; k++) mean += fA[rows[k]] + fB[rows[k]];
+	mean /= 2*n;
+	for(int k = 0; k < n; k++)
+	{
+		variance += (fA[rows[k]] - mean)*(fA[rows[k]] - mean) + (fB[rows[k]] - mean)*(fB[rows[k]] - mean);
+	}
+	variance /= 2*n;
+
+	first.assign(d, 0);
+	total.assign(d, 0);
+	for(int i = 0; i < d; i++)
+	{
+		double s1 = 0, st = 0;
+		for(int k = 0; k < n; k++)
+		{
+			int j = rows[k];
+			double ab = fAB[j*d + i];
+			s1 += fB[j]*(ab - fA[j]);
+			st += (fA[j] - ab)*(fA[j] - ab);
+		}
+		first[i] = variance > 0 ? s1 / n / variance : 0;
+		total[i] = variance > 0 ? st / (2*n) / variance : 0;
+	}
+}
+
+void Sensitivity::run(std::ostream& out)
+{
+	int d = dims.size();
+	std::vector<std::string> names = metricNames();
+	int m = names.size();
+
+	boost::uniform_real<> uniform(0, 1);
+	std::vector<std::vector<double> > A(samples, std::vector<double>(d)), B(samples, std::vector<double>(d));
+	for(int j = 0; j < samples; j++)
+	{
+		for(int i = 0; i < d; i++) A[j][i] = uniform(rng);
+		for(int i = 0; i < d; i++) B[j][i] = uniform(rng);
+	}
+
+	//per metric: f(A), f(B) and f(AB_i)
+	std::vector<std::vector<double> > fA(m, std::vector<double>(samples)), fB(m, std::vector<double>(samples));
+	std::vector<std::vector<double> > fAB(m, std::vector<double>(samples*d));
+
+	for(int start = 0; start < samples; start += chunkRows)
+	{
+		int end = std::min(samples, start + chunkRows);
+		std::vector<PropertyMap> points;
+		for(int j = start; j < end; j++)
+		{
+			points.push_back(toProperties(dims, A[j]));
+			points.push_back(toProperties(dims, B[j]));
+			for(int i = 0; i < d; i++)
+			{
+				std::vector<double> ab(A[j]);
+				ab[i] = B[j][i];
+				points.push_back(toProperties(dims, ab));
+			}
+		}
+		std::vector<RunResult> results = runner->run(points);
+		for(int j = start; j < end; j++)
+		{
+			int base = (j - start)*(d + 2);
+			std::vector<double> a = metrics(results[base]);
+			std::vector<double> b = metrics(results[base + 1]);
+			for(int k = 0; k < m; k++)
+			{
+				fA[k][j] = a[k];
+				fB[k][j] = b[k];
+			}
+			for(int i = 0; i < d; i++)
+			{
+				std::vector<double> ab = metrics(results[base + 2 + i]);
+				for(int k = 0; k < m; k++)
+				{
+					fAB[k][j*d + i] = ab[k];
+				}
+			}
+		}
+		std::cout << "sensitivity: " << end*(d + 2) << " of " << samples*(d + 2) << " runs" << std::endl;
+	}
+
+	out << "Metric,Parameter,S1,S1.conf,ST,ST.conf" << std::endl;
+	std::vector<int> rows(samples);
+	for(int j = 0; j < samples; j++) rows[j] = j;
+	boost::uniform_int<> pick(0, samples - 1);
+	const int resamples = 200;
+	for(int k = 0; k < m; k++)
+	{
+		std::vector<double> first, total;
+		estimate(fA[k], fB[k], fAB[k], rows, first, total);
+
+		//bootstrap over sample rows for 95% confidence half-widths
+		std::vector<double> sumS1(d, 0), sumS1Sq(d, 0), sumST(d, 0), sumSTSq(d, 0);
+		std::vector<int> resampled(samples);
+		for(int r = 0; r < resamples; r++)
+		{
+			for(int j = 0; j < samples; j++) resampled[j] = pick(rng);
+			std::vector<double> bFirst, bTotal;
+			estimate(fA[k], fB[k], fAB[k], resampled, bFirst, bTotal);
+			for(int i = 0; i < d; i++)
+			{
+				sumS1[i] += bFirst[i];
+				sumS1Sq[i] += bFirst[i]*bFirst[i];
+				sumST[i] += bTotal[i];
+				sumSTSq[i] += bTotal[i]*bTotal[i];
+			}
+		}
+		for(int i = 0; i < d; i++)
+		{
+			double sdS1 = sqrt(std::max(0.0, sumS1Sq[i]/resamples - pow(sumS1[i]/resamples, 2)));
+			double sdST = sqrt(std::max(0.0, sumSTSq[i]/resamples - pow(sumST[i]/resamples, 2)));
+			out << names[k] << "," << dims[i].key << "," << first[i] << "," << 1.96*sdS1 << "," << total[i] << "," << 1.96*sdST << std::endl;
+		}
+	}
+}
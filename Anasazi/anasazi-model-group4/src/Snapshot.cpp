@@ -0,0 +1,302 @@
+#include <stdint.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include "ByteCodec.h"
+#include "Snapshot.h"
+
+static const char snapshotMagic[8] = {'A', 'N', 'A', 'S', 'N', 'A', 'P', '1'};
+
+SnapshotWriter::SnapshotWriter(const std::string& file, int sizeX, int sizeY, int laneCount, int compression)
+	: out(file.c_str(), std::ios::binary)
+{
+	boardSizeX = sizeX;
+	boardSizeY = sizeY;
+	lanes = laneCount;
+	level = compression;
+	closing = false;
+	previous.resize(lanes);
+	stream.zalloc = Z_NULL;
+	stream.zfree = Z_NULL;
+	stream.opaque = Z_NULL;
+	if(!out)
+	{
+		std::cerr << "snapshot: cannot open " << file << std::endl;
+		return;
+	}
+	if(deflateInit2(&stream, level, Z_DEFLATED, 15, 8, level == 1 ? Z_HUFFMAN_ONLY : Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		std::cerr << "snapshot: zlib cannot compress at level " << level << std::endl;
+		out.close();
+		return;
+	}
+
+	out.write(snapshotMagic, sizeof(snapshotMagic));
+	putInt(out, boardSizeX);
+	putInt(out, boardSizeY);
+	putInt(out, lanes);
+	thread = std::thread(&SnapshotWriter::worker, this);
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+	close();
+}
+
+void SnapshotWriter::write(SnapshotFrame& frame)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	queue.push_back(SnapshotFrame());
+	std::swap(queue.back(), frame);
+	if(queue.size() >= FRAMES_PER_RECORD)
+	{
+		ready.notify_one();
+	}
+}
+
+void SnapshotWriter::close()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closing = true;
+		ready.notify_one();
+	}
+	if(thread.joinable())
+	{
+		thread.join();
+		deflateEnd(&stream);
+	}
+	if(out.is_open())
+	{
+		out.close();
+	}
+}
+
+//a frame is a few hundred bytes, too small for deflate to pay for its block
+//headers, so FRAMES_PER_RECORD frames are encoded back to back and compressed
+//together. The varint deltas hardly repeat as strings, so level 1 codes them with
+//Huffman codes alone, which packs them as tightly as a match search in less time
+void SnapshotWriter::worker()
+{
+	std::string bytes;
+	std::vector<unsigned char> packed;
+	std::deque<SnapshotFrame> frames;
+	while(1)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while(queue.size() < FRAMES_PER_RECORD && !closing)
+			{
+				ready.wait(lock);
+			}
+			if(queue.empty())
+			{
+				return;
+			}
+			frames.swap(queue);
+		}
+
+		bytes.clear();
+		for(size_t i = 0; i < frames.size(); i++)
+		{
+			encode(frames[i], bytes);
+			std::swap(previous[frames[i].lane], frames[i]);
+		}
+		frames.clear();
+		packed.resize(deflateBound(&stream, bytes.size()));
+		deflateReset(&stream);
+		stream.next_in = (Bytef*)bytes.data();
+		stream.avail_in = bytes.size();
+		stream.next_out = &packed[0];
+		stream.avail_out = packed.size();
+		deflate(&stream, Z_FINISH);
+		uint32_t packedSize = stream.total_out;
+		putInt(out, bytes.size());
+		putInt(out, packedSize);
+		out.write((const char*)&packed[0], packedSize);
+	}
+}
+
+//households are matched to the previous frame by id; both lists ascend by id
+void SnapshotWriter::encode(const SnapshotFrame& frame, std::string& bytes)
+{
+	const SnapshotFrame& last = previous[frame.lane];
+	putVarint(bytes, frame.lane);
+	putSigned(bytes, frame.year);
+	const std::vector<SnapshotCell>& changed = frame.changedCells;
+	putVarint(bytes, changed.size());
+	int lastCell = -1;
+	for(size_t i = 0; i < changed.size(); i++)
+	{
+		putVarint(bytes, changed[i].cell - lastCell - 1);
+		bytes.push_back(changed[i].state);
+		lastCell = changed[i].cell;
+	}
+
+	putVarint(bytes, frame.households.size());
+	size_t j = 0;
+	int lastId = -1;
+	for(size_t i = 0; i < frame.households.size(); i++)
+	{
+		const SnapshotHousehold& h = frame.households[i];
+		while(j < last.households.size() && last.households[j].id < h.id)
+		{
+			j++;
+		}
+		SnapshotHousehold base = {h.id, 0, 0, 0, 0};
+		if(j < last.households.size() && last.households[j].id == h.id)
+		{
+			base = last.households[j];
+		}
+		putVarint(bytes, h.id - lastId - 1);
+		putSigned(bytes, h.cell - base.cell);
+		putSigned(bytes, h.field - base.field);
+		putSigned(bytes, h.maizeStorage - base.maizeStorage);
+		putSigned(bytes, h.age - base.age);
+		lastId = h.id;
+	}
+}
+
+SnapshotReader::SnapshotReader(const std::string& file)
+	: in(file.c_str(), std::ios::binary)
+{
+	boardSizeX = boardSizeY = lanes = 0;
+	pos = 0;
+	char magic[sizeof(snapshotMagic)];
+	uint32_t x, y, l;
+	if(!in.read(magic, sizeof(magic)) || std::string(magic, sizeof(magic)) != std::string(snapshotMagic, sizeof(snapshotMagic))
+		|| !getInt(in, x) || !getInt(in, y) || !getInt(in, l))
+	{
+		std::cerr << "snapshot: " << file << " is not a snapshot stream" << std::endl;
+		in.close();
+		return;
+	}
+	boardSizeX = x;
+	boardSizeY = y;
+	lanes = l;
+	previous.resize(lanes);
+	for(int i = 0; i < lanes; i++)
+	{
+		previous[i].cellState.assign(boardSizeX*boardSizeY, 0);
+	}
+}
+
+SnapshotReader::~SnapshotReader() {}
+
+bool SnapshotReader::next(SnapshotFrame& frame)
+{
+	if(pos >= bytes.size())
+	{
+		uint32_t rawSize, packedSize;
+		if(!in.is_open() || !getInt(in, rawSize) || !getInt(in, packedSize))
+		{
+			return false;
+		}
+		std::vector<unsigned char> packed(packedSize);
+		bytes.assign(rawSize, '\0');
+		pos = 0;
+		uLongf size = rawSize;
+		if(!in.read((char*)&packed[0], packedSize)
+			|| uncompress((Bytef*)&bytes[0], &size, &packed[0], packedSize) != Z_OK || size != rawSize)
+		{
+			std::cerr << "snapshot: truncated or corrupt record" << std::endl;
+			return false;
+		}
+	}
+
+	int lane = getVarint(bytes, pos);
+	if(lane >= lanes)
+	{
+		std::cerr << "snapshot: frame for unknown lane " << lane << std::endl;
+		return false;
+	}
+	const SnapshotFrame& last = previous[lane];
+	frame.lane = lane;
+	frame.year = getSigned(bytes, pos);
+	frame.cellState = last.cellState;
+	uint32_t changed = getVarint(bytes, pos);
+	int cell = -1;
+	for(uint32_t i = 0; i < changed; i++)
+	{
+		cell += 1 + getVarint(bytes, pos);
+		if(cell >= (int)frame.cellState.size() || pos >= bytes.size())
+		{
+			std::cerr << "snapshot: bad cell in frame" << std::endl;
+			return false;
+		}
+		frame.cellState[cell] = bytes[pos++];
+	}
+
+	uint32_t count = getVarint(bytes, pos);
+	if(count > bytes.size() - pos)
+	{
+		std::cerr << "snapshot: bad household count in frame" << std::endl;
+		return false;
+	}
+	frame.households.resize(count);
+	size_t j = 0;
+	int lastId = -1;
+	for(size_t i = 0; i < frame.households.size(); i++)
+	{
+		SnapshotHousehold& h = frame.households[i];
+		h.id = lastId + 1 + getVarint(bytes, pos);
+		while(j < last.households.size() && last.households[j].id < h.id)
+		{
+			j++;
+		}
+		SnapshotHousehold base = {h.id, 0, 0, 0, 0};
+		if(j < last.households.size() && last.households[j].id == h.id)
+		{
+			base = last.households[j];
+		}
+		h.cell = base.cell + getSigned(bytes, pos);
+		h.field = base.field + getSigned(bytes, pos);
+		h.maizeStorage = base.maizeStorage + getSigned(bytes, pos);
+		h.age = base.age + getSigned(bytes, pos);
+		lastId = h.id;
+	}
+	previous[lane] = frame;
+	return true;
+}
+
+bool writeSnapshotTables(const std::string& snapshotFile, std::ostream& households, std::ostream& cells)
+{
+	SnapshotReader reader(snapshotFile);
+	if(!reader.isOpen())
+	{
+		return false;
+	}
+	int sizeY = reader.getBoardSizeY();
+	households << "Lane,Year,Id,X,Y,FieldX,FieldY,MaizeStorage,Age" << std::endl;
+	cells << "Lane,Year,X,Y,State" << std::endl;
+	SnapshotFrame frame;
+	while(reader.next(frame))
+	{
+		for(size_t i = 0; i < frame.households.size(); i++)
+		{
+			const SnapshotHousehold& h = frame.households[i];
+			households << frame.lane << "," << frame.year << "," << h.id << "," << h.cell / sizeY << "," << h.cell % sizeY << ",";
+			if(h.field >= 0)
+			{
+				households << h.field / sizeY << "," << h.field % sizeY;
+			}
+			else
+			{
+				households << ",";
+			}
+			households << "," << h.maizeStorage << "," << h.age << "\n";
+		}
+		for(size_t c = 0; c < frame.cellState.size(); c++)
+		{
+			if(frame.cellState[c] != 0)
+			{
+				cells << frame.lane << "," << frame.year << "," << c / sizeY << "," << c % sizeY << "," << (int)frame.cellState[c] << "\n";
+			}
+		}
+	}
+	households.flush();
+	cells.flush();
+	return true;
+}
@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BatchRunner.h"
+#include "Drivers.h"
+#include "Landscape.h"
+#include "LockstepEngine.h"
+#include "ResultStore.h"
+
+/* make check: one parameter vector is stored through BatchRunner (calibrate and
+ * sensitivity runs) and through runEngine (single runs), its values written
+ * differently, and a single query must find both runs */
+static int failures = 0;
+
+static void expect(bool condition, const std::string& what)
+{
+	std::cout << (condition ? "ok      " : "FAILED  ") << what << std::endl;
+	failures += !condition;
+}
+
+int main(int argc, char** argv){
+	const std::string storeFile = "./bin/check_results.store";
+	remove(storeFile.c_str());
+	PropertyMap props = readProperties("props/model.props", argc - 1, argv + 1);
+	props["run.mode"] = "model";
+	props["replicate.lanes"] = "1";
+	props["results.store"] = storeFile;
+	props["result.file"] = "./bin/check_households.csv";
+	props.erase("results.parameters");
+	props.erase("snapshot.file");
+	props.erase("stats.file");
+
+	EngineParameters param = EngineParameters::fromProperties(props);
+	Landscape landscape(param.boardSizeX, param.boardSizeY);
+	if(!loadLandscape(landscape, props))
+	{
+		std::cout << "FAILED  data files did not load" << std::endl;
+		return 1;
+	}
+
+	PropertyMap overrides;
+	overrides["fertility.prop"] = "0.12";
+	overrides["harvest.adj"] = "0.7";
+	{
+		ResultStore store(storeFile);
+		BatchRunner runner(&landscape, props, laneSeeds(props), 1);
+		runner.storeResults(&store, std::vector<double>());
+		runner.runOne(overrides);
+	}
+	PropertyMap single(props);
+	single["fertility.prop"] = "0.12000";
+	single["harvest.adj"] = "0.700";
+	expect(runEngine(single) == 0, "the single run succeeded");
+
+	ResultReader reader(storeFile);
+	expect(reader.size() == 2, "both drivers appended a run");
+	PropertyMap filed = recordedParameters(single);
+	std::vector<int> found = reader.find(filed);
+	expect(found.size() == 2, "one indexed query finds both runs");
+	expect(reader.size() == 2 && reader.getHash(0) == reader.getHash(1), "both runs carry the same parameter hash");
+	StoredRun a, b;
+	expect(reader.size() == 2 && reader.read(0, a) && reader.read(1, b) && a.households == b.households,
+			"the runs have the same trajectory");
+
+	std::ostringstream runs;
+	writeResultTables(storeFile, "fertility.prop=0.12,harvest.adj=0.70", runs, NULL);
+	int rows = 0;
+	for(size_t i = 0; i < runs.str().size(); i++)
+	{
+		rows += runs.str()[i] == '\n';
+	}
+	expect(rows == 3, "a partial query lists both runs");
+
+	remove(storeFile.c_str());
+	remove(props["result.file"].c_str());
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+#!/bin/bash
+
+# Compares the Repast model's households per year with a baseline revision's,
+# run from the model directory after make all. The baseline is built in a
+# scratch worktree; both run random.seed 1..SEEDS. Random streams differ between
+# revisions, so runs are compared in distribution: a year deviates when the two
+# means differ by more than 3 standard errors, and the check fails when more
+# than MAX_DEVIATING percent of the years deviate or when the households
+# averaged over a run differ by more than 3 standard errors. Per-year means go
+# to demography_check.csv. Runs vary widely, so a shift of a few percent needs
+# SEEDS in the hundreds to show.
+props_file="props/model.props"
+baseline=${BASELINE:-$(git rev-list --max-parents=0 HEAD)}
+seeds=${SEEDS:-20}
+max_deviating=${MAX_DEVIATING:-2}
+
+if [ ! -x bin/main.exe ] || [ ! -f "$props_file" ]; then
+    echo "Error: run from the model directory after make all."
+    exit 1
+fi
+if [ "$seeds" -lt 2 ]; then
+    echo "Error: SEEDS must be at least 2."
+    exit 1
+fi
+
+model_dir=$(git rev-parse --show-prefix)
+worktree=$(mktemp -d)
+runs=$(mktemp -d)
+trap 'git worktree remove --force "$worktree"; rm -rf "$runs"' EXIT
+
+echo "Building baseline $baseline..."
+git worktree add --detach "$worktree" "$baseline" > /dev/null || exit 1
+(cd "$worktree/$model_dir" && make all > "$runs/baseline_build.log" 2>&1)
+if [ $? -ne 0 ]; then
+    echo "Error building the baseline, see its log:"
+    cat "$runs/baseline_build.log"
+    exit 1
+fi
+
+for seed in $(seq 1 $seeds); do
+    echo "Running seed $seed..."
+    mpirun -n 1 bin/main.exe props/config.props $props_file random.seed=$seed result.file=$runs/model_$seed.csv < /dev/null
+    if [ $? -ne 0 ]; then
+        echo "Error executing mpirun command"
+        exit 1
+    fi
+    (cd "$worktree/$model_dir" && mpirun -n 1 bin/main.exe props/config.props props/model.props random.seed=$seed result.file=$runs/baseline_$seed.csv < /dev/null)
+    if [ $? -ne 0 ]; then
+        echo "Error executing the baseline mpirun command"
+        exit 1
+    fi
+done
+
+# "Year,Number-of-Households,maxCapacity" rows of every run, tagged by side and seed
+for side in baseline model; do
+    for seed in $(seq 1 $seeds); do
+        awk -F',' -v side=$side -v seed=$seed 'NR > 1 { print side "," seed "," $1 "," $2 }' $runs/${side}_$seed.csv
+    done
+done | awk -F',' -v limit=$max_deviating '
+    function welch(na, ma, qa, nb, mb, qb,    va, vb, se) {
+        va = (qa - na * ma * ma) / (na - 1); vb = (qb - nb * mb * mb) / (nb - 1)
+        se = sqrt((va > 0 ? va : 0) / na + (vb > 0 ? vb : 0) / nb)
+        return se > 0 ? (mb - ma) / se : (ma == mb ? 0 : 99)
+    }
+    {
+        n[$1, $3]++; sum[$1, $3] += $4; sq[$1, $3] += $4 * $4; years[$3] = 1
+        runSum[$1, $2] += $4; runYears[$1, $2]++; runs[$1, $2] = $1
+    }
+    END {
+        count = 0; deviating = 0
+        for(y in years) {
+            count++
+            mb = sum["baseline", y] / n["baseline", y]; mm = sum["model", y] / n["model", y]
+            z = welch(n["baseline", y], mb, sq["baseline", y], n["model", y], mm, sq["model", y])
+            if(z > 3 || z < -3) deviating++
+            printf "%d,%g,%g,%g,%g\n", y, mb, mm, mm - mb, z
+        }
+        #households averaged over each run, one value per seed
+        for(r in runs) {
+            side = runs[r]; mean = runSum[r] / runYears[r]
+            rn[side]++; rs[side] += mean; rq[side] += mean * mean
+        }
+        rz = welch(rn["baseline"], rs["baseline"] / rn["baseline"], rq["baseline"], rn["model"], rs["model"] / rn["model"], rq["model"])
+        printf "mean households per run: baseline %g, model %g (z = %.2f)\n", rs["baseline"] / rn["baseline"], rs["model"] / rn["model"], rz > "/dev/stderr"
+        printf "%d of %d years deviate by more than 3 standard errors\n", deviating, count > "/dev/stderr"
+        exit(deviating * 100 > limit * count || rz > 3 || rz < -3)
+    }' > $runs/years.csv
+status=$?
+echo "Year,Baseline.Mean,Model.Mean,Difference,Z" > demography_check.csv
+sort -n $runs/years.csv >> demography_check.csv
+if [ $status -ne 0 ]; then
+    echo "Demography differs from the baseline, see demography_check.csv"
+fi
+exit $status
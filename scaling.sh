@@ -0,0 +1,53 @@
+#!/bin/bash
+
+# Strong- and weak-scaling sweep, run from the model directory after make all.
+# Every proc.per.x x proc.per.y layout runs the same seed; the slowest rank of
+# each is compared with the first layout in scaling_layouts.csv. The engine
+# sweep (threads, synthetic boards) goes to scaling_threads.csv.
+props_file="props/model.props"
+layouts=${LAYOUTS:-"1x1 1x2 2x1 2x2"}
+threads=${THREADS:-"1,2,4"}
+tiles=${TILES:-"1,2,4"}
+seed=${SEED:-1}
+
+if [ ! -f "$props_file" ]; then
+    echo "Error: Properties file '$props_file' not found."
+    exit 1
+fi
+
+echo "Layout,Ranks,Seconds,TicksPerSecond,Speedup,Efficiency,Landscape.Seconds,Output.Seconds,Households.Seconds,Network.Seconds" > scaling_layouts.csv
+base_seconds=""
+base_ranks=""
+for layout in $layouts; do
+    px=${layout%x*}
+    py=${layout#*x}
+    ranks=$((px * py))
+    timing_file="timing_$layout.csv"
+
+    echo "Running $layout on $ranks ranks..."
+    mpirun -n $ranks bin/main.exe props/config.props $props_file proc.per.x=$px proc.per.y=$py random.seed=$seed timing.file=$timing_file
+    if [ $? -ne 0 ]; then
+        echo "Error executing mpirun command"
+        exit 1
+    fi
+
+    # the slowest rank bounds the tick rate
+    row=$(awk -F',' 'NR > 1 && $6 >= max { max = $6; row = $0 } END { print row }' $timing_file)
+    seconds=$(echo "$row" | cut -d',' -f6)
+    if [ -z "$base_seconds" ]; then
+        base_seconds=$seconds
+        base_ranks=$ranks
+    fi
+    echo "$row" | awk -F',' -v layout=$layout -v ranks=$ranks -v t0=$base_seconds -v p0=$base_ranks \
+        '{ speedup = t0 / $6; printf "%s,%d,%g,%g,%g,%g,%s,%s,%s,%s\n", layout, ranks, $6, $7, speedup, speedup * p0 / ranks, $8, $9, $10, $11 }' >> scaling_layouts.csv
+done
+
+echo "Running the engine thread and board sweep..."
+mpirun -n 1 bin/main.exe props/config.props $props_file run.mode=scaling scaling.threads=$threads scaling.tiles=$tiles random.seed=$seed scaling.result.file=scaling_threads.csv
+if [ $? -ne 0 ]; then
+    echo "Error executing mpirun command"
+    exit 1
+fi
+
+cat scaling_layouts.csv
+cat scaling_threads.csv
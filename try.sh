@@ -1,6 +1,10 @@
 #!/bin/bash
 #set -x  # 启用调试
+# 每行参数跑一次 Repast 模型（main.exe），参数以 key=value 覆盖传入，不再改写 model.props。
+# run.mode=worker 只加载一次景观、速度更快，但它跑的是 lockstep 引擎而不是 Repast 模型，
+# 结果只在分布上与模型一致，所以这里不用它。
 output_prefix="./outputdatas/target_data"  # 修改保存路径
+results_store="./outputdatas/results.store"  # 所有运行追加到同一个结果文件
 # Specify the CSV file and model.props file
 csv_file="samestep1.csv"
 props_file="props/model.props"
@@ -10,47 +14,23 @@ echo "Number of lines in the CSV file: $line_count"
 # 初始化计数器
 counter=1
 # Process each line of the CSV file
-#i=1
-#while [ "$i" -lt 5 ]; do
 while IFS=',' read -r corn1 corn2 corn3 corn4 corn5; do
 
-                                                                           
-    # 检查 model.props 是否有写入权限
-    # if [ ! -w "$props_file" ]; then
-    #     echo "Error: No write permission for '$props_file'."
-    #     exit 1
-    # fi                                                                      
-    # Update the model.props file
+    echo "Running model with values: $corn1, $corn2, $corn3, $corn4, $corn5"
 
-     echo "Updating model.props with values: $corn1, $corn2, $corn3, $corn4, $corn5"
-
-     sed -i "s/^\(max\.fission\.age\s*=\s*\).*\$/\1$corn1/" $props_file
-     #sed -i "s/^\(min\.fission\.age\s*=\s*\).*\$/\1$corn1/" $props_file
-    
-     sed -i "s/^\(max\.death\.age\s*=\s*\).*\$/\1$corn2/" $props_file
-     #sed -i "s/^\(min\.death\.age\s*=\s*\).*\$/\1$corn2/" $props_file
-
-     sed -i "s/^\(annual\.variance\s*=\s*\).*\$/\1$corn3/" $props_file
-
-     sed -i "s/^\(fertility\.prop\s*=\s*\).*\$/\1$corn4/" $props_file
-
-     sed -i "s/^\(harvest\.adj\s*=\s*\).*\$/\1$corn5/" $props_file
-
-    
-    echo "准备运行 mpirun 命令..."
-    mpirun -n 1 bin/main.exe props/config.props props/model.props < /dev/null
-    #exit_status=$?
-    #echo "mpirun 命令${counter}执行完毕，退出状态：$exit_status"
-
-
-
-    # 重命名输出文件为 target_data+counter.csv，并移动到新路径
+    # 重命名输出文件为 target_data+counter.csv，并保存到新路径
     output_file="${output_prefix}${counter}.csv"
-    cp "NumberOfHousehold.csv" "$output_file"
+    mpirun -n 1 bin/main.exe props/config.props $props_file \
+        max.fission.age=$corn1 max.death.age=$corn2 annual.variance=$corn3 fertility.prop=$corn4 harvest.adj=$corn5 \
+        result.file=$output_file results.store=$results_store < /dev/null
+    if [ $? -ne 0 ]; then
+        echo "Error executing mpirun command"
+        exit 1
+    fi
 
-    echo "计数器现在的值: $counter"
     echo "采样矩阵第${counter}行处理完成。"
-    # 等待 mpirun 进程完成
     ((counter++))
-    #i=$((i+1))
-done < "$csv_file"
\ No newline at end of file
+done < "$csv_file"
+
+# 轨迹已追加到 $results_store，用 run.mode=results 导出
+echo "所有运行完成，共 $line_count 行。"